@@ -0,0 +1,254 @@
+// bench/compression_bench.cc
+//
+// Throughput (MB/s), time per 64-byte line and compression ratio of every codec
+// over synthetic data profiles and optional dump files, on Google
+// Benchmark. Besides the usual --benchmark_* flags it takes
+//   --dump=<file>   add the contents of a file as a profile, repeatable
+//   --size=<bytes>  size of the synthetic profiles, 1 MiB by default
+// Use --benchmark_format=json or --benchmark_out=<file> to keep results
+// for comparison across releases.
+#include "compression/adaptive.h"
+#include "compression/ans.h"
+#include "compression/bdi.h"
+#include "compression/cpack.h"
+#include "compression/fpc.h"
+#include "compression/huffman.h"
+#include "compression/lz4.h"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Profile {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+struct Codec {
+    std::string name;
+    std::function<std::unique_ptr<compression::CompressionBase>()> make;
+};
+
+template<typename T>
+void append(std::vector<uint8_t>& data, T value) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+std::vector<uint8_t> makeZeros(size_t size) {
+    return std::vector<uint8_t>(size, 0);
+}
+
+// int32 counters and indexes, mostly near zero
+std::vector<uint8_t> makeSmallInts(size_t size) {
+    std::mt19937 gen(1);
+    std::geometric_distribution<int32_t> magnitude(0.05);
+    std::vector<uint8_t> data;
+    while (data.size() < size) {
+        int32_t value = magnitude(gen);
+        append<int32_t>(data, gen() & 1 ? value : -value);
+    }
+    data.resize(size);
+    return data;
+}
+
+// 8-byte aligned heap pointers clustered in a few regions, some null
+std::vector<uint8_t> makePointers(size_t size) {
+    std::mt19937 gen(2);
+    const uint64_t regions[] = {0x00007f3a12400000, 0x00007f3a9c000000, 0x0000561e3a200000};
+    std::vector<uint8_t> data;
+    while (data.size() < size) {
+        uint64_t pointer = 0;
+        if (gen() % 8 != 0) {
+            pointer = regions[gen() % 3] + (gen() % (1 << 20)) * 8;
+        }
+        append<uint64_t>(data, pointer);
+    }
+    data.resize(size);
+    return data;
+}
+
+// float samples of a slowly varying signal with noise
+std::vector<uint8_t> makeFloats(size_t size) {
+    std::mt19937 gen(3);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    std::vector<uint8_t> data;
+    for (size_t i = 0; data.size() < size; i++) {
+        append<float>(data, 100.0f + 10.0f * std::sin(i * 0.001f) + noise(gen));
+    }
+    data.resize(size);
+    return data;
+}
+
+// English-like words with Zipf-ish frequencies
+std::vector<uint8_t> makeText(size_t size) {
+    static const char* const words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was",
+        "with", "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at",
+        "which", "but", "have", "an", "had", "they", "you", "were", "their", "one", "all",
+        "we", "can", "her", "has", "there", "been", "if", "more", "when", "will", "would",
+        "who", "so", "no", "compression", "memory", "cache", "line", "pattern", "value"};
+    const size_t num_words = std::size(words);
+    std::vector<double> weights(num_words);
+    for (size_t i = 0; i < num_words; i++) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    std::mt19937 gen(4);
+    std::discrete_distribution<size_t> word(weights.begin(), weights.end());
+    std::vector<uint8_t> data;
+    while (data.size() < size) {
+        const char* w = words[word(gen)];
+        data.insert(data.end(), w, w + std::strlen(w));
+        data.push_back(gen() % 12 == 0 ? '\n' : ' ');
+    }
+    data.resize(size);
+    return data;
+}
+
+std::vector<uint8_t> makeRandom(size_t size) {
+    std::mt19937 gen(5);
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(gen());
+    }
+    return data;
+}
+
+std::vector<Codec> codecs() {
+    return {
+        {"BDI", [] { return std::make_unique<compression::BDI>(); }},
+        {"FPC", [] { return std::make_unique<compression::FPC>(); }},
+        {"CPack", [] { return std::make_unique<compression::CPack>(); }},
+        {"LZ4", [] { return std::make_unique<compression::LZ4Codec>(); }},
+        {"Huffman", [] { return std::make_unique<compression::HuffmanCodec>(); }},
+        {"ANS", [] { return std::make_unique<compression::ANS>(); }},
+        {"Adaptive", [] { return std::make_unique<compression::Adaptive>(); }},
+    };
+}
+
+// MB/s from bytes processed, time per line and ratio as counters
+void setCounters(benchmark::State& state, size_t input_size, size_t compressed_size) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input_size));
+    // seconds per line, the inverse of the line rate
+    double lines = static_cast<double>(input_size) / compression::CompressionBase::LINE_SIZE;
+    state.counters["time_per_line"] = benchmark::Counter(
+        lines, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    state.counters["ratio"] = compressed_size > 0
+        ? static_cast<double>(input_size) / compressed_size : 0.0;
+}
+
+void benchCompress(benchmark::State& state, const Codec& codec, const Profile& profile) {
+    auto compressor = codec.make();
+    const std::vector<uint8_t>& input = profile.data;
+    std::vector<uint8_t> output(compressor->maxCompressedSize(input.size()));
+    size_t compressed_size = 0;
+    for (auto _ : state) {
+        compressed_size = compressor->compress(input.data(), input.size(),
+                                               output.data(), output.size());
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, input.size(), compressed_size);
+}
+
+void benchDecompress(benchmark::State& state, const Codec& codec, const Profile& profile) {
+    auto compressor = codec.make();
+    const std::vector<uint8_t>& input = profile.data;
+    std::vector<uint8_t> compressed = compressor->compress(input);
+    std::vector<uint8_t> output(input.size());
+
+    // a fresh instance, as a reader on the other side would have
+    auto decompressor = codec.make();
+    if (decompressor->decompress(compressed) != input) {
+        state.SkipWithError("round trip mismatch");
+        return;
+    }
+    for (auto _ : state) {
+        decompressor->decompress(compressed.data(), compressed.size(),
+                                 output.data(), output.size());
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    setCounters(state, input.size(), compressed.size());
+}
+
+bool readFile(const std::string& path, Profile& profile) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    profile.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    size_t slash = path.find_last_of('/');
+    profile.name = slash == std::string::npos ? path : path.substr(slash + 1);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // take out our own flags, Google Benchmark rejects unknown ones
+    size_t size = 1 << 20;
+    std::vector<std::string> dumps;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--dump=", 0) == 0) {
+            dumps.push_back(arg.substr(7));
+        } else if (arg.rfind("--size=", 0) == 0) {
+            size = std::stoull(arg.substr(7));
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    std::vector<Profile> profiles = {
+        {"zeros", makeZeros(size)},
+        {"small_ints", makeSmallInts(size)},
+        {"pointers", makePointers(size)},
+        {"floats", makeFloats(size)},
+        {"text", makeText(size)},
+        {"random", makeRandom(size)},
+    };
+    for (const std::string& path : dumps) {
+        Profile profile;
+        if (!readFile(path, profile)) {
+            std::cerr << "cannot read " << path << "\n";
+            return 1;
+        }
+        profiles.push_back(std::move(profile));
+    }
+
+    // profiles and codecs outlive the run, the benchmarks point into them
+    const std::vector<Codec> all_codecs = codecs();
+    for (const Codec& codec : all_codecs) {
+        for (const Profile& profile : profiles) {
+            const Codec* c = &codec;
+            const Profile* p = &profile;
+            std::string suffix = "/" + codec.name + "/" + profile.name;
+            benchmark::RegisterBenchmark(("compress" + suffix).c_str(),
+                                         [c, p](benchmark::State& state) { benchCompress(state, *c, *p); });
+            benchmark::RegisterBenchmark(("decompress" + suffix).c_str(),
+                                         [c, p](benchmark::State& state) { benchDecompress(state, *c, *p); });
+        }
+    }
+
+    benchmark::AddCustomContext("synthetic_profile_bytes", std::to_string(size));
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
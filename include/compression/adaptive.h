@@ -0,0 +1,102 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include "compression_base.h"
+#include "bdi.h"
+#include "cpack.h"
+#include "fpc.h"
+#include <cstdint>
+
+namespace compression {
+
+// Best-of meta codec over 64-byte lines: every line is coded with whichever
+// of BDI, FPC and CPack makes it smallest, or stored raw, and a 2-bit
+// selector records the choice.
+//
+// Output, little endian:
+//   uint32 original size
+//   one descriptor byte per whole line: selector in the top 2 bits, the
+//   coded size (1..63) in the low 6 bits, 0 for a raw line
+//   the coded lines back to back, raw lines as their 64 bytes
+//   a trailing partial line as is
+// In compressLines the record tag is the selector.
+class Adaptive : public CompressionBase {
+public:
+    enum Selector : uint8_t {
+        RAW = 0,
+        BDI_LINE = 1,
+        FPC_LINE = 2,
+        CPACK_LINE = 3
+    };
+
+    // bit i enables the codec of selector i, raw is always available
+    static constexpr uint8_t ENABLE_BDI = 1 << BDI_LINE;
+    static constexpr uint8_t ENABLE_FPC = 1 << FPC_LINE;
+    static constexpr uint8_t ENABLE_CPACK = 1 << CPACK_LINE;
+    static constexpr uint8_t ENABLE_ALL = ENABLE_BDI | ENABLE_FPC | ENABLE_CPACK;
+
+    static constexpr size_t HEADER_SIZE = 4;
+
+    // How a line's codec is found: EXHAUSTIVE compresses the line with
+    // every enabled codec, PREDICTED runs BDI and predicts the FPC and
+    // CPack sizes from one pass over the line's words, then compresses
+    // only with the winner. A line BDI codes in 4 bytes or fewer skips the
+    // prediction. Both pick the same codec; ties go to the lower selector.
+    enum class Selection {
+        EXHAUSTIVE,
+        PREDICTED
+    };
+
+    explicit Adaptive(uint8_t enabled = ENABLE_ALL);
+    ~Adaptive() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+    using CompressionBase::compressLines;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override {
+        return HEADER_SIZE + src_size / LINE_SIZE + src_size;
+    }
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    size_t compressLines(const uint8_t* src, size_t num_lines,
+                         uint8_t* dst, size_t dst_capacity,
+                         LineRecord* records) override;
+    void decompressLines(const uint8_t* src, size_t src_size,
+                         const LineRecord* records, size_t num_lines,
+                         uint8_t* dst) override;
+
+    void setSelection(Selection selection) {
+        selection_ = selection;
+    }
+
+    // lines coded by each selector since construction or resetStats
+    const uint64_t* selectorCounts() const {
+        return counts_;
+    }
+    void resetStats() {
+        std::fill(counts_, counts_ + 4, 0);
+    }
+
+private:
+    // code one line into dst (room for LINE_SIZE bytes), return the
+    // selector and set size to the bytes written
+    Selector compressLine(const uint8_t* line, uint8_t* dst, size_t& size);
+    // decode a line coded by compressLine
+    void decompressLine(Selector selector, const uint8_t* src, size_t size, uint8_t* dst);
+
+    BDI bdi_;
+    FPC fpc_;
+    CPack cpack_;
+    uint8_t enabled_;
+    Selection selection_ = Selection::PREDICTED;
+    uint64_t counts_[4] = {};
+};
+
+} // namespace compression
+
+#endif // ADAPTIVE_H
@@ -0,0 +1,81 @@
+#ifndef ANS_H
+#define ANS_H
+
+#include "compression_base.h"
+#include <cstdint>
+#include <vector>
+
+namespace compression {
+
+// Order-0 table-based ANS (tANS, as in FSE) over bytes. Symbol counts are
+// normalized to 1 << table_log, and every state of the table stands for
+// one symbol, so skewed data costs a fraction of a bit per symbol where
+// Huffman pays at least one.
+//
+// Output, little endian:
+//   uint32 original size, uint8 mode, then by mode
+//   RAW: the input bytes, used when coding does not shrink the input
+//   RLE: the one byte value the input repeats
+//   CODED: uint8 table log, uint8 largest symbol, the normalized count
+//          of every symbol up to it as a LEB128 varint, then the bitstream
+// The encoder codes the input back to front into an LSB-first bitstream,
+// even and odd positions with two interleaved states, and ends it with
+// both final states and a 1 bit, so the decoder reads the stream from its
+// end and produces the input front to back.
+class ANS : public CompressionBase {
+public:
+    enum Mode : uint8_t {
+        RAW = 0,
+        RLE = 1,
+        CODED = 2
+    };
+
+    static constexpr size_t HEADER_SIZE = 5;
+    static constexpr int MIN_TABLE_LOG = 5;
+    static constexpr int MAX_TABLE_LOG = 12;
+    static constexpr int DEFAULT_TABLE_LOG = 11;
+
+    // larger tables follow the counts more closely and cost more to build
+    explicit ANS(int table_log = DEFAULT_TABLE_LOG);
+    ~ANS() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override {
+        return src_size + HEADER_SIZE;
+    }
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    // Scale counts of num_symbols symbols to sum to 1 << table_log, every
+    // symbol that occurs keeping at least 1. Rounding is settled one step
+    // at a time where it costs the fewest bits.
+    static void normalizeCounts(const uint32_t* counts, int num_symbols,
+                                int table_log, uint16_t* normalized);
+
+private:
+    struct DecodeEntry {
+        uint16_t newState;
+        uint8_t symbol;
+        uint8_t nbBits;
+    };
+
+    // symbol of every state, spread over the table so that each symbol's
+    // states are interleaved with the others
+    static void spreadSymbols(const uint16_t* normalized, int max_symbol,
+                              int table_log, uint8_t* spread);
+
+    int table_log_;
+    // reused between calls
+    std::vector<uint8_t> stream_;
+    std::vector<uint16_t> stateTable_;
+    std::vector<DecodeEntry> decodeTable_;
+};
+
+} // namespace compression
+
+#endif // ANS_H
@@ -14,8 +14,50 @@ public:
     BDI();
     ~BDI() override = default;
 
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) override;
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) override;
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+    using CompressionBase::compressLines;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override;
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    // the tag of a line record is the line's encoding byte
+    size_t compressLines(const uint8_t* src, size_t num_lines,
+                         uint8_t* dst, size_t dst_capacity,
+                         LineRecord* records) override;
+
+    // BDI works on 64-byte cache lines; a compressed line is an encoding
+    // byte followed by at most one line of payload
+    static constexpr size_t MAX_BLOCK_SIZE = 1 + LINE_SIZE;
+
+    // How compressBlock picks among the base+delta encodings that fit:
+    // FIRST_FIT takes the first one in encoding table order, SMALLEST the
+    // one with the smallest compSize. All-zero and repeated-value lines
+    // always take ZEROS/REPEAT.
+    enum class Selection {
+        FIRST_FIT,
+        SMALLEST
+    };
+
+    void setSelection(Selection selection) {
+        selection_ = selection;
+    }
+
+    // Dual-base mode additionally tries every base+delta encoding with two
+    // bases, an implicit zero base and an explicit one, picked per element
+    // by a bitmask. Decoding handles both forms regardless of the mode.
+    void setDualBase(bool dual_base) {
+        dual_base_ = dual_base;
+    }
+
+protected:
+    size_t streamUnit() const override {
+        return LINE_SIZE;
+    }
 
 private:
     // change encoding according to compression length
@@ -27,11 +69,41 @@ private:
     static constexpr uint8_t BASE4_DELTA2 = 0b00000101;
     static constexpr uint8_t BASE2_DELTA1 = 0b00000110;
     static constexpr uint8_t BASE8_DELTA4 = 0b00000111;
+    static constexpr uint8_t ZEROS        = 0b00001000;
+
+    // flag on BASE8_DELTA1..BASE8_DELTA4: the base is preceded by a bitmask
+    // with one bit per element, set if the element is relative to the
+    // explicit base and clear if it is relative to zero
+    static constexpr uint8_t DUAL_BASE    = 0b00010000;
+
+    // BASE8_DELTA1..BASE8_DELTA4 and their dual-base forms in the two
+    // Selection orders
+    static constexpr uint8_t NUM_DELTA_ENCODINGS = BASE8_DELTA4 - BASE8_DELTA1 + 1;
+    uint8_t first_fit_order_[2 * NUM_DELTA_ENCODINGS];
+    uint8_t smallest_order_[2 * NUM_DELTA_ENCODINGS];
+
+    Selection selection_ = Selection::SMALLEST;
+    bool dual_base_ = false;
+
+    bool isValidEncoding(uint8_t encoding) const {
+        if (encoding & DUAL_BASE) {
+            uint8_t single = encoding & ~DUAL_BASE;
+            return single >= BASE8_DELTA1 && single <= BASE8_DELTA4;
+        }
+        return encoding <= ZEROS;
+    }
 
-    uint32_t compSize(uint8_t encoding) {
+    uint32_t compSize(uint8_t encoding) const {
+        if (encoding & DUAL_BASE) {
+            // one mask bit per element
+            uint8_t single = encoding & ~DUAL_BASE;
+            return compSize(single) + LINE_SIZE / getBaseSize(single) / 8;
+        }
         switch (encoding) {
             case UNCOMPRESSED:
                 return 64;
+            case ZEROS:
+                return 0;
             case REPEAT:
                 return 8;
             case BASE8_DELTA1:
@@ -52,8 +124,9 @@ private:
     }
 
 
-    uint8_t getBaseSize(uint8_t encoding) {
-        if (encoding == BASE8_DELTA1 || encoding == BASE8_DELTA2 || encoding == BASE8_DELTA4) {
+    uint8_t getBaseSize(uint8_t encoding) const {
+        encoding &= ~DUAL_BASE;
+        if (encoding == REPEAT || encoding == BASE8_DELTA1 || encoding == BASE8_DELTA2 || encoding == BASE8_DELTA4) {
             return 8;
         } else if (encoding == BASE4_DELTA1 || encoding == BASE4_DELTA2) {
             return 4;
@@ -63,7 +136,8 @@ private:
         return 0;
     }
 
-    uint8_t getDeltaSize(uint8_t encoding) {
+    uint8_t getDeltaSize(uint8_t encoding) const {
+        encoding &= ~DUAL_BASE;
         if (encoding == BASE8_DELTA1 || encoding == BASE4_DELTA1 || encoding == BASE2_DELTA1) {
             return 1;
         } else if (encoding == BASE8_DELTA2 || encoding == BASE4_DELTA2) {
@@ -74,7 +148,8 @@ private:
         return 0;
     }
 
-    int64_t getDeltaLimitMax(uint8_t encoding) {
+    int64_t getDeltaLimitMax(uint8_t encoding) const {
+        encoding &= ~DUAL_BASE;
         if (encoding == BASE8_DELTA1 || encoding == BASE4_DELTA1 || encoding == BASE2_DELTA1) {
             return INT8_MAX;
         } else if (encoding == BASE8_DELTA2 || encoding == BASE4_DELTA2) {
@@ -85,7 +160,8 @@ private:
         return 0;
     }   
 
-    int64_t getDeltaLimitMin(uint8_t encoding) {
+    int64_t getDeltaLimitMin(uint8_t encoding) const {
+        encoding &= ~DUAL_BASE;
         if (encoding == BASE8_DELTA1 || encoding == BASE4_DELTA1 || encoding == BASE2_DELTA1) {
             return INT8_MIN;
         } else if (encoding == BASE8_DELTA2 || encoding == BASE4_DELTA2) {
@@ -96,23 +172,33 @@ private:
         return 0;
     }
 
-    struct CompressedBlock {
-        uint8_t encoding;
-        uint64_t base;
-        std::vector<uint8_t> deltas;
-    };
-
-    CompressedBlock compressBlkEncode(const std::vector<uint8_t>& data, size_t offset, uint8_t encoding);
-    CompressedBlock compressBlock(const std::vector<uint8_t>& data, size_t offset);
-    std::vector<uint8_t> decompressBlock(const std::vector<uint8_t>& data, size_t& offset);
-    uint64_t findBase(const std::vector<uint8_t>& data, size_t offset, uint8_t base_size);
+    // encode one full line with the given encoding into dst, the caller
+    // has checked that the deltas fit
+    void compressBlkEncode(const uint8_t* line, uint8_t encoding, uint8_t* dst);
+    // encode one full line with a dual-base encoding into dst, false if
+    // some element fits neither base
+    bool compressDualEncode(const uint8_t* line, uint8_t encoding, uint8_t* dst);
+    // encode a line of size bytes into dst, return the compressed size
+    size_t compressBlock(const uint8_t* line, size_t size, uint8_t* dst);
+    // decode the block at src[offset] into dst, advance offset and
+    // return the number of bytes written
+    size_t decompressBlock(const uint8_t* src, size_t src_size, size_t& offset,
+                           uint8_t* dst, size_t dst_capacity);
+    uint64_t findBase(const uint8_t* line, uint8_t base_size);
+    // compress src line by line, recording each line when records is set
+    size_t compressRange(const uint8_t* src, size_t src_size,
+                         uint8_t* dst, size_t dst_capacity, LineRecord* records);
 
 public:
 
     std::string getEncodingName(uint8_t encoding) {
+        if ((encoding & DUAL_BASE) && isValidEncoding(encoding)) {
+            return "DUAL_" + getEncodingName(encoding & ~DUAL_BASE);
+        }
         switch (encoding) {
             case UNCOMPRESSED: return "UNCOMPRESSED";
             case REPEAT: return "REPEAT";
+            case ZEROS: return "ZEROS";
             case BASE8_DELTA1: return "BASE8_DELTA1";
             case BASE8_DELTA2: return "BASE8_DELTA2";
             case BASE8_DELTA4: return "BASE8_DELTA4";
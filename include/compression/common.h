@@ -3,10 +3,13 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstring>
 #include <unordered_map>
 #include <list>
 #include <string>
 #include <optional>
+#include <stdexcept>
+#include <cstdio>
 
 using std::vector;
 using std::pair;
@@ -20,6 +23,121 @@ int64_t getValue(const std::vector<uint8_t>& data, size_t offset, size_t i) {
     return static_cast<int64_t>(temp);
 }
 
+// load a little-endian value of type T from an unaligned pointer
+template<typename T>
+T loadValue(const uint8_t* p) {
+    T temp;
+    std::memcpy(&temp, p, sizeof(T));
+    return temp;
+}
+
+// store a value of type T to an unaligned pointer
+template<typename T>
+void storeValue(uint8_t* p, T value) {
+    std::memcpy(p, &value, sizeof(T));
+}
+
+
+// MSB-first bit writer over a caller-provided buffer
+class BitWriter {
+private:
+    uint8_t* dst_;
+    size_t capacity_;
+    size_t pos_ = 0;
+    // pending bits live in the low bits_ bits of acc_
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+
+public:
+    // bits not yet written out, to carry a stream over to another BitWriter
+    struct State {
+        uint64_t acc = 0;
+        unsigned bits = 0;
+    };
+
+    BitWriter(uint8_t* dst, size_t capacity) : dst_(dst), capacity_(capacity) {}
+    BitWriter(uint8_t* dst, size_t capacity, State state)
+        : dst_(dst), capacity_(capacity), acc_(state.acc), bits_(state.bits) {}
+
+    State state() const {
+        return {acc_, bits_};
+    }
+
+    // whole bytes written so far
+    size_t written() const {
+        return pos_;
+    }
+
+    // append the low nbits (<= 32) of value
+    void put(uint32_t value, unsigned nbits) {
+        acc_ = (acc_ << nbits) | (value & ((uint64_t(1) << nbits) - 1));
+        bits_ += nbits;
+        while (bits_ >= 8) {
+            if (pos_ >= capacity_) {
+                throw std::runtime_error("Output buffer too small");
+            }
+            bits_ -= 8;
+            dst_[pos_++] = static_cast<uint8_t>(acc_ >> bits_);
+        }
+    }
+
+    // pad the last partial byte with one bits, return bytes written
+    size_t finish() {
+        if (bits_ > 0) {
+            put((1u << (8 - bits_)) - 1, 8 - bits_);
+        }
+        return pos_;
+    }
+};
+
+// MSB-first bit reader, reading past the end yields zero bits
+class BitReader {
+private:
+    const uint8_t* src_;
+    size_t size_;
+    size_t pos_ = 0;
+    // buffered bits are left aligned in acc_
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+
+    void refill() {
+        while (bits_ <= 56 && pos_ < size_) {
+            acc_ |= uint64_t(src_[pos_++]) << (56 - bits_);
+            bits_ += 8;
+        }
+    }
+
+public:
+    BitReader(const uint8_t* src, size_t size) : src_(src), size_(size) {}
+
+    // look at the next nbits (1..32) without consuming them
+    uint32_t peek(unsigned nbits) {
+        if (bits_ < nbits) {
+            refill();
+        }
+        return static_cast<uint32_t>(acc_ >> (64 - nbits));
+    }
+
+    // consume nbits (< 57), the caller checks bitsLeft() beforehand
+    void skip(unsigned nbits) {
+        if (bits_ < nbits) {
+            refill();
+        }
+        acc_ <<= nbits;
+        bits_ -= nbits;
+    }
+
+    uint32_t get(unsigned nbits) {
+        uint32_t value = peek(nbits);
+        skip(nbits);
+        return value;
+    }
+
+    size_t bitsLeft() const {
+        return bits_ + (size_ - pos_) * 8;
+    }
+};
+
 
 class Dictionary {
 private:
@@ -32,15 +150,54 @@ private:
 
     // Structure to hold the dictionary entry and its metadata
     struct Entry {
-        uint32_t key;      // Full 32-bit key
-        uint32_t value; // Value associated with the key
+        uint32_t value;                         // Value associated with the key
+        uint32_t slot;                          // Stable index of the entry
+        std::list<uint32_t>::iterator lru;      // Position in lru_list_
     };
-    
+
     // LRU list to track usage (most recent at front)
     std::list<uint32_t> lru_list_;
-    
-    // Main storage: key -> (value, lru_iterator)
-    std::unordered_map<uint32_t, std::pair<uint32_t, std::list<uint32_t>::iterator>> storage_;
+
+    // Main storage: key -> entry
+    std::unordered_map<uint32_t, Entry> storage_;
+
+    // slot -> key, slots are reused when an entry is evicted so the
+    // index of an entry stays below max_size_
+    std::vector<uint32_t> slots_;
+
+    // Partial-match indexes: upper 24/16 bits -> keys sharing them
+    static constexpr uint32_t MASK_24BIT = 0xFFFFFF00;
+    static constexpr uint32_t MASK_16BIT = 0xFFFF0000;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> prefix24_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> prefix16_;
+
+    static void index_remove(std::unordered_map<uint32_t, std::vector<uint32_t>>& index,
+                             uint32_t prefix, uint32_t key) {
+        auto it = index.find(prefix);
+        auto& keys = it->second;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) {
+                keys[i] = keys.back();
+                keys.pop_back();
+                break;
+            }
+        }
+        if (keys.empty()) {
+            index.erase(it);
+        }
+    }
+
+    // Look up a prefix index, mark the hit as used and return its slot
+    std::optional<uint32_t> find_prefix(std::unordered_map<uint32_t, std::vector<uint32_t>>& index,
+                                        uint32_t prefix) {
+        auto it = index.find(prefix);
+        if (it == index.end()) {
+            return std::nullopt;
+        }
+        uint32_t key = it->second.back();
+        update_lru(key);
+        return storage_.find(key)->second.slot;
+    }
 
     // Update LRU for a given key
     void update_lru(uint32_t key) {
@@ -50,79 +207,90 @@ private:
 
         auto it = storage_.find(key);
         if (it != storage_.end()) {
-            lru_list_.erase(it->second.second);
+            lru_list_.erase(it->second.lru);
             lru_list_.push_front(key);
-            it->second.second = lru_list_.begin();
+            it->second.lru = lru_list_.begin();
         }
     }
 
-    // Remove least recently used entry
-    void remove_lru() {
-        if (!lru_list_.empty()) {
-            uint32_t last_key = lru_list_.back();
-            lru_list_.pop_back();
-            storage_.erase(last_key);
-        }
+    // Remove least recently used entry, return its slot
+    uint32_t remove_lru() {
+        uint32_t last_key = lru_list_.back();
+        lru_list_.pop_back();
+        auto it = storage_.find(last_key);
+        uint32_t slot = it->second.slot;
+        storage_.erase(it);
+        index_remove(prefix24_, last_key & MASK_24BIT, last_key);
+        index_remove(prefix16_, last_key & MASK_16BIT, last_key);
+        return slot;
     }
 
 public:
-    explicit Dictionary(size_t max_size = 1000) : max_size_(max_size) {}
+    explicit Dictionary(size_t max_size = 1000) : max_size_(max_size) {
+        slots_.reserve(max_size);
+    }
 
-    // Insert or update a key-value pair
-    void insert(uint32_t key, const uint32_t& value) {
+    // Insert or update a key-value pair, return the slot of the entry
+    uint32_t insert(uint32_t key, const uint32_t& value) {
         // If key exists, update it
-        if (storage_.find(key) != storage_.end()) {
-            storage_[key].first = value;
+        auto it = storage_.find(key);
+        if (it != storage_.end()) {
+            it->second.value = value;
             update_lru(key);
-            return;
+            return it->second.slot;
         }
 
-        // If at capacity, remove LRU entry
+        // If at capacity, reuse the slot of the LRU entry
+        uint32_t slot;
         if (storage_.size() >= max_size_) {
-            remove_lru();
+            slot = remove_lru();
+            slots_[slot] = key;
+        } else {
+            slot = static_cast<uint32_t>(slots_.size());
+            slots_.push_back(key);
         }
 
         // Insert new entry
         lru_list_.push_front(key);
-        storage_[key] = {value, lru_list_.begin()};
+        storage_[key] = {value, slot, lru_list_.begin()};
+        prefix24_[key & MASK_24BIT].push_back(key);
+        prefix16_[key & MASK_16BIT].push_back(key);
+        return slot;
+    }
+
+    // Insert a key that is its own value
+    uint32_t insert(uint32_t key) {
+        return insert(key, key);
     }
 
-    // Search by exact 32-bit key
-    bool find_exact(uint32_t key) {
+    // Search by exact 32-bit key, return the slot on a hit
+    std::optional<uint32_t> find_exact(uint32_t key) {
         auto it = storage_.find(key);
         if (it != storage_.end()) {
             update_lru(key);
-            return true;
+            return it->second.slot;
         }
-        return  false;
+        return std::nullopt;
     }
 
-    // Search by first 24 bits
-    bool find_24bit(uint32_t prefix) {
-        uint32_t mask = 0xFFFFFF00;
-        prefix &= mask;
+    // Search by first 24 bits, the most recently inserted key wins
+    std::optional<uint32_t> find_24bit(uint32_t prefix) {
+        return find_prefix(prefix24_, prefix & MASK_24BIT);
+    }
 
-        for (const auto& [key, value] : storage_) {
-            if ((key & mask) == prefix) {
-                update_lru(key);
-                return true;
-            }
-        }
-        return false;
+    // Search by first 16 bits, the most recently inserted key wins
+    std::optional<uint32_t> find_16bit(uint32_t prefix) {
+        return find_prefix(prefix16_, prefix & MASK_16BIT);
     }
 
-    // Search by first 16 bits
-    bool find_16bit(uint32_t prefix) {
-        uint32_t mask = 0xFFFF0000;
-        prefix &= mask;
+    // Key stored in a slot returned by insert or find_*
+    uint32_t at(uint32_t slot) const {
+        return slots_.at(slot);
+    }
 
-        for (const auto& [key, value] : storage_) {
-            if ((key & mask) == prefix) {
-                update_lru(key);
-                return true;
-            }
-        }
-        return false;
+    // Mark the entry in a slot as used, mirrors the lru update of a find_*
+    void touch(uint32_t slot) {
+        update_lru(slots_.at(slot));
     }
 
     // Get current size
@@ -130,10 +298,18 @@ public:
         return storage_.size();
     }
 
+    // Get maximum size
+    size_t capacity() const {
+        return max_size_;
+    }
+
     // Clear the dictionary
     void clear() {
         storage_.clear();
         lru_list_.clear();
+        slots_.clear();
+        prefix24_.clear();
+        prefix16_.clear();
     }
 
     void setFreeze(bool freeze) {
@@ -143,8 +319,171 @@ public:
     // print the dictionary
     void print() const {
         printf("Dictionary size: %zu\n", storage_.size());
-        for (const auto& [key, value] : storage_) {
-            printf("key: %08X, value: %08X\n", key, value.first);
+        for (const auto& [key, entry] : storage_) {
+            printf("key: %08X, value: %08X\n", key, entry.value);
+        }
+    }
+};
+
+// SIMD kernels of FixedDictionary, built for several instruction sets in
+// src/dict_kernel.cc and picked at run time
+namespace dict_kernel {
+
+// Bitmap of the first n keys (n a multiple of 4, at most 64, keys 16-byte
+// aligned) whose bits under mask equal those of key
+using MatchFn = uint64_t (*)(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask);
+
+uint64_t matchScalar(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask);
+uint64_t matchSSE2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask);
+uint64_t matchAVX2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask);
+uint64_t matchAVX512(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask);
+
+// Best kernel for the running CPU
+MatchFn matcher();
+
+} // namespace dict_kernel
+
+// Replacement policies of FixedDictionary
+enum class DictReplacement {
+    FIFO,   // evict slots round robin, hits do not change the order
+    PLRU    // bit pseudo-LRU: evict the first slot not used since the last reset
+};
+
+// Flat, fixed-capacity word dictionary for hardware-style CPack. Keys live
+// in an aligned array of N words (16 entries fill one cache line) that is
+// searched with the widest SIMD compares the CPU has; nothing is allocated
+// after construction.
+// The interface mirrors Dictionary so both can back the CPack codec.
+template <size_t N, DictReplacement R = DictReplacement::PLRU>
+class FixedDictionary {
+    static_assert(N > 0 && N <= 64 && N % 4 == 0,
+                  "FixedDictionary holds 4 to 64 entries in steps of 4");
+
+private:
+    alignas(64) uint32_t keys_[N] = {};
+    // number of usable entries, at most N
+    size_t max_size_;
+    // max_size_ rounded up to the SIMD width
+    size_t scan_size_;
+    size_t size_ = 0;
+    bool freeze_ = false;
+    // FIFO: next slot to replace
+    size_t next_ = 0;
+    // PLRU: one bit per recently used slot
+    uint64_t mru_ = 0;
+
+    uint64_t validMask() const {
+        return size_ == 64 ? ~uint64_t(0) : (uint64_t(1) << size_) - 1;
+    }
+
+    // bitmap of the slots whose masked key equals masked key
+    uint64_t match(uint32_t key, uint32_t mask) const {
+        static const dict_kernel::MatchFn fn = dict_kernel::matcher();
+        return fn(keys_, scan_size_, key, mask) & validMask();
+    }
+
+    std::optional<uint32_t> find(uint32_t key, uint32_t mask) {
+        uint64_t hits = match(key, mask);
+        if (hits == 0) {
+            return std::nullopt;
+        }
+        uint32_t slot = static_cast<uint32_t>(__builtin_ctzll(hits));
+        touch(slot);
+        return slot;
+    }
+
+    uint32_t victim() {
+        if (R == DictReplacement::FIFO) {
+            uint32_t slot = static_cast<uint32_t>(next_);
+            next_ = (next_ + 1) % max_size_;
+            return slot;
+        }
+        // only a single-entry dictionary has every slot marked
+        uint64_t candidates = ~mru_ & validMask();
+        return candidates ? static_cast<uint32_t>(__builtin_ctzll(candidates)) : 0;
+    }
+
+public:
+    explicit FixedDictionary(size_t max_size = N)
+        : max_size_(max_size), scan_size_((max_size + 3) & ~size_t(3)) {
+        if (max_size == 0 || max_size > N) {
+            throw std::invalid_argument("FixedDictionary size out of range");
+        }
+    }
+
+    // Insert a key, return its slot
+    uint32_t insert(uint32_t key) {
+        uint64_t hits = match(key, 0xFFFFFFFF);
+        if (hits != 0) {
+            uint32_t slot = static_cast<uint32_t>(__builtin_ctzll(hits));
+            touch(slot);
+            return slot;
+        }
+
+        uint32_t slot;
+        if (size_ < max_size_) {
+            slot = static_cast<uint32_t>(size_++);
+        } else {
+            slot = victim();
+        }
+        keys_[slot] = key;
+        touch(slot);
+        return slot;
+    }
+
+    // Search by exact 32-bit key, return the slot on a hit
+    std::optional<uint32_t> find_exact(uint32_t key) {
+        return find(key, 0xFFFFFFFF);
+    }
+
+    // Search by first 24 bits, the lowest matching slot wins
+    std::optional<uint32_t> find_24bit(uint32_t prefix) {
+        return find(prefix, 0xFFFFFF00);
+    }
+
+    // Search by first 16 bits, the lowest matching slot wins
+    std::optional<uint32_t> find_16bit(uint32_t prefix) {
+        return find(prefix, 0xFFFF0000);
+    }
+
+    uint32_t at(uint32_t slot) const {
+        return keys_[slot];
+    }
+
+    // Mark a slot as used
+    void touch(uint32_t slot) {
+        if (R != DictReplacement::PLRU || freeze_) {
+            return;
+        }
+        mru_ |= uint64_t(1) << slot;
+        if (mru_ == (max_size_ == 64 ? ~uint64_t(0) : (uint64_t(1) << max_size_) - 1)) {
+            mru_ = uint64_t(1) << slot;
+        }
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t capacity() const {
+        return max_size_;
+    }
+
+    // stale keys past size_ are masked out by match()
+    void clear() {
+        size_ = 0;
+        next_ = 0;
+        mru_ = 0;
+    }
+
+    void setFreeze(bool freeze) {
+        freeze_ = freeze;
+    }
+
+    void print() const {
+        printf("Dictionary size: %zu\n", size_);
+        for (size_t i = 0; i < size_; i++) {
+            printf("slot: %zu, key: %08X\n", i, keys_[i]);
         }
     }
 };
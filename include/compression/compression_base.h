@@ -1,26 +1,157 @@
 #ifndef COMPRESSION_BASE_H
 #define COMPRESSION_BASE_H
 
+#include <algorithm>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <cstdio>
+#include <stdexcept>
 namespace compression {
 
 class CompressionBase {
 public:
     virtual ~CompressionBase() = default;
-    
-    // Pure virtual functions that derived classes must implement
-    virtual std::vector<uint8_t> compress(const std::vector<uint8_t>& data) = 0;
-    virtual std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) = 0;
-    
-    // Common utility functions can be added here    
+
+    // Pure virtual functions that derived classes must implement.
+    // compress/decompress read src_size bytes from src and write into the
+    // caller-provided dst buffer, returning the number of bytes written.
+    // They throw std::runtime_error if dst_capacity is too small or the
+    // compressed input is malformed.
+    virtual size_t compress(const uint8_t* src, size_t src_size,
+                            uint8_t* dst, size_t dst_capacity) = 0;
+    virtual size_t decompress(const uint8_t* src, size_t src_size,
+                              uint8_t* dst, size_t dst_capacity) = 0;
+
+    // Upper bound of the compressed size of src_size input bytes
+    virtual size_t maxCompressedSize(size_t src_size) const = 0;
+
+    // Exact size of the data encoded in a compressed buffer
+    virtual size_t decompressedSize(const uint8_t* src, size_t src_size) const = 0;
+
+    // Batch interface over 64-byte lines. Every line is compressed on its
+    // own and the results are stored back to back, so line i starts at the
+    // sum of the sizes of the lines before it.
+    static constexpr size_t LINE_SIZE = 64;
+
+    struct LineRecord {
+        uint8_t size;   // compressed size of the line in bytes
+        uint8_t tag;    // codec specific, BDI stores the line's encoding
+    };
+
+    // Compress num_lines lines of src into dst and fill records[num_lines],
+    // return the number of bytes written
+    virtual size_t compressLines(const uint8_t* src, size_t num_lines,
+                                 uint8_t* dst, size_t dst_capacity,
+                                 LineRecord* records) {
+        size_t written = 0;
+        for (size_t i = 0; i < num_lines; i++) {
+            size_t size = compress(src + i * LINE_SIZE, LINE_SIZE,
+                                   dst + written, dst_capacity - written);
+            records[i].size = static_cast<uint8_t>(size);
+            records[i].tag = lineTag(dst + written, size);
+            written += size;
+        }
+        return written;
+    }
+
+    // Decompress the output of compressLines into num_lines lines of dst
+    virtual void decompressLines(const uint8_t* src, size_t src_size,
+                                 const LineRecord* records, size_t num_lines,
+                                 uint8_t* dst) {
+        size_t offset = 0;
+        for (size_t i = 0; i < num_lines; i++) {
+            if (src_size - offset < records[i].size ||
+                decompress(src + offset, records[i].size,
+                           dst + i * LINE_SIZE, LINE_SIZE) != LINE_SIZE) {
+                throw std::runtime_error("Invalid compressed line");
+            }
+            offset += records[i].size;
+        }
+    }
+
+    // Vector form of compressLines, payload and records keep their
+    // capacity across calls
+    void compressLines(const uint8_t* src, size_t num_lines,
+                       std::vector<uint8_t>& payload, std::vector<LineRecord>& records) {
+        payload.resize(num_lines * maxCompressedSize(LINE_SIZE));
+        records.resize(num_lines);
+        payload.resize(compressLines(src, num_lines, payload.data(), payload.size(),
+                                     records.data()));
+    }
+
+    // Streaming interface. begin() starts a stream, update() takes input
+    // of any size and writes out every complete unit (a BDI line, an FPC or
+    // CPack word), carrying the rest to the next call, and finish() flushes
+    // the remainder. The concatenated output equals compress() of the
+    // concatenated input, so decompress() reads it unchanged.
+    virtual void begin() {
+        stream_pending_.clear();
+    }
+
+    virtual size_t update(const uint8_t* src, size_t src_size,
+                          uint8_t* dst, size_t dst_capacity) {
+        size_t unit = streamUnit();
+        size_t written = 0;
+        if (unit == 0) {
+            throw std::runtime_error("Streaming not supported");
+        }
+
+        // complete the unit left over from the previous call
+        if (!stream_pending_.empty()) {
+            size_t take = std::min(unit - stream_pending_.size(), src_size);
+            stream_pending_.insert(stream_pending_.end(), src, src + take);
+            src += take;
+            src_size -= take;
+            if (stream_pending_.size() < unit) {
+                return 0;
+            }
+            written = compress(stream_pending_.data(), unit, dst, dst_capacity);
+            stream_pending_.clear();
+        }
+
+        size_t full_size = src_size - src_size % unit;
+        written += compress(src, full_size, dst + written, dst_capacity - written);
+        stream_pending_.assign(src + full_size, src + src_size);
+        return written;
+    }
+
+    virtual size_t finish(uint8_t* dst, size_t dst_capacity) {
+        size_t written = compress(stream_pending_.data(), stream_pending_.size(),
+                                  dst, dst_capacity);
+        stream_pending_.clear();
+        return written;
+    }
+
+    // Output bound of one update() of src_size bytes, and of finish()
+    // with src_size 0
+    size_t maxUpdateSize(size_t src_size) const {
+        return maxCompressedSize(src_size + streamUnit()) + 1;
+    }
+
+    // Vector convenience wrappers around the buffer interface
+    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> compressed(maxCompressedSize(data.size()));
+        compressed.resize(compress(data.data(), data.size(),
+                                   compressed.data(), compressed.size()));
+        return compressed;
+    }
+
+    std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) {
+        std::vector<uint8_t> decompressed(
+            decompressedSize(compressed_data.data(), compressed_data.size()));
+        decompressed.resize(decompress(compressed_data.data(), compressed_data.size(),
+                                       decompressed.data(), decompressed.size()));
+        return decompressed;
+    }
+
+    // Common utility functions can be added here
     void print_bytes(const std::vector<uint8_t>& data, size_t bytes_per_row) {
         printf("Data size: %zu\n", data.size());
         for (size_t i = 0; i < data.size(); i++) {
             // Print byte in hexadecimal format with leading zeros
             printf("%02X ", data[i]);
-            
+
             // Add newline after every bytes_per_row bytes
             if ((i + 1) % bytes_per_row == 0 || i == data.size() - 1) {
                 printf("\n");
@@ -29,8 +160,25 @@ public:
     }
 protected:
     CompressionBase() = default;
+
+    // bytes a streaming codec encodes independently of what follows,
+    // 0 for codecs that need the whole input at once
+    virtual size_t streamUnit() const {
+        return 0;
+    }
+
+    // tag of a compressed line for LineRecord
+    virtual uint8_t lineTag(const uint8_t* compressed, size_t size) const {
+        (void)compressed;
+        (void)size;
+        return 0;
+    }
+
+private:
+    // input carried between update() calls, less than one streamUnit()
+    std::vector<uint8_t> stream_pending_;
 };
 
 } // namespace compression
 
-#endif // COMPRESSION_BASE_H 
\ No newline at end of file
+#endif // COMPRESSION_BASE_H
@@ -7,24 +7,57 @@
 #include <cstdint>
 #include <string>
 #include <iomanip>
+#include <sstream>
 
 namespace compression {
 
 class CPack : public CompressionBase {
 public:
-    CPack();
+    // dict_entries sets the dictionary size and with it the width of the
+    // dictionary index, the default 16 entries give the 4-bit indices below.
+    // Up to FLAT_DICT_ENTRIES entries are kept in a FixedDictionary with
+    // pseudo-LRU replacement, larger dictionaries use the LRU Dictionary.
+    explicit CPack(size_t dict_entries = 16);
     ~CPack() override = default;
 
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) override;
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) override;
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    // compress/decompress start from an empty dictionary, so every
+    // compressed buffer can be decoded on its own
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override;
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    // The stream keeps the dictionary and the unfinished bits and partial
+    // word between updates, compress() in between restarts it
+    void begin() override;
+    size_t update(const uint8_t* src, size_t src_size,
+                  uint8_t* dst, size_t dst_capacity) override;
+    size_t finish(uint8_t* dst, size_t dst_capacity) override;
+
+    // CPack works on 4-byte words
+    static constexpr size_t WORD_SIZE = 4;
+    static constexpr size_t FLAT_DICT_ENTRIES = 64;
 
     /*
+     * Codes are written MSB first into a bit stream (b: dict index bit,
+     * B: unmatched byte, unmatched bytes are written low byte first):
+     *
      * 00 - zzzz (00) zero pattern                              2-bit
      * 01 - xxxx (01)BBBB  none-match           B: real data    34-bit
      * 10 - mmmm (10)bbbb  match-dictionary     b: dict index   6-bit
      * 1100 - mmxx (1100)bbbbBB partial-match index+unmatchdata 24-bit
      * 1101 - zzzx (1101)B zero+unmatchdata                     12-bit
      * 1110 - mmmx (1110)bbbbB partial-match index+unmatchdata  16-bit
+     * 1111 - (1111)nnB..B trailing partial word of n bytes     6+8n-bit
+     *
+     * The stream is padded with one bits to a byte boundary. Partial
+     * matches and misses push the word into the dictionary, the decoder
+     * replays the same updates to mirror the encoder's dictionary.
     */
     static constexpr uint8_t ZERO_PATTERN       = 0x00;
     static constexpr uint8_t NONE_MATCH         = 0x01;
@@ -32,6 +65,7 @@ public:
     static constexpr uint8_t PARTIAL_MATCH_2B   = 0x03;
     static constexpr uint8_t ZERO_UNMATCH       = 0x04;
     static constexpr uint8_t PARTIAL_MATCH_3B   = 0x05;
+    static constexpr uint8_t PARTIAL_WORD       = 0x06;
 
     std::string
     getPatternName(uint8_t pattern) const {
@@ -42,6 +76,7 @@ public:
             case PARTIAL_MATCH_2B: return "PARTIAL_MATCH_2B";
             case ZERO_UNMATCH: return "ZERO_UNMATCH";
             case PARTIAL_MATCH_3B: return "PARTIAL_MATCH_3B";
+            case PARTIAL_WORD: return "PARTIAL_WORD";
         }
         return "UNKNOWN";
     }
@@ -49,58 +84,95 @@ public:
     struct Compressed2Word {
         uint8_t     pattern = 0;
         uint32_t    dict_index = 0;
-        std::vector<uint8_t> unmatch_data;
+        uint8_t     unmatch_size = 0;
+        uint8_t     unmatch_data[4] = {0, 0, 0, 0};
     };
 
     // print out pattern and dict_index and also every element in unmatch_data
     std::string printCompressed2Word(const Compressed2Word& block) const {
         std::string result = std::string(getPatternName(block.pattern)) + " " + std::to_string(block.dict_index) + " ";
-        for (const auto& data : block.unmatch_data) {
+        for (uint8_t i = 0; i < block.unmatch_size; i++) {
             std::stringstream ss;
-            ss << std::hex << static_cast<int>(data);
+            ss << std::hex << static_cast<int>(block.unmatch_data[i]);
             result += ss.str() + " ";
         }
         return result;
     }
 
     uint32_t getCompBlkSize(uint8_t pattern) const {
-        // this is the size of pattern + dict_index + unmatch_data
+        // this is the size of the code in bits: prefix + dict index + unmatch data
         // like partial match 2B, it has 2B unmatch data
         // like zero unmatch, it has 1B unmatch data
-        // zero pattern and none match does not have unmatch data
+        // zero pattern and none match do not have a dict index
         if (pattern == ZERO_PATTERN) {
-            return 1 + 4;
+            return 2;
         } else if (pattern == NONE_MATCH) {
-            return 1 + 4 + 64;
+            return 2 + 32;
         } else if (pattern == MATCH_DICT) {
-            return 1 + 4;
+            return 2 + index_bits_;
         } else if (pattern == PARTIAL_MATCH_2B) {
-            return 1 + 4 + 2;
+            return 4 + index_bits_ + 16;
         } else if (pattern == ZERO_UNMATCH) {
-            return 1 + 4 + 1;
+            return 4 + 8;
         } else if (pattern == PARTIAL_MATCH_3B) {
-            return 1 + 4 + 2;
+            return 4 + index_bits_ + 8;
         }
         return 0;
     }
 
     void setFreeze(bool freeze) {
         dict_.setFreeze(freeze);
+        flat_dict_.setFreeze(freeze);
     }
 
     void printDict() const {
-        dict_.print();
+        if (use_flat_dict_) {
+            flat_dict_.print();
+        } else {
+            dict_.print();
+        }
     }
 
-private:
-    Compressed2Word compress2Word(const std::vector<uint8_t>& data, size_t offset, size_t size);
-    std::vector<uint8_t> decompress2Word(const std::vector<uint8_t>& data, size_t& offset);
-
-    Compressed2Word compress2Word(const uint32_t& data);
+protected:
+    size_t streamUnit() const override {
+        return WORD_SIZE;
+    }
 
+private:
+    template <typename Dict>
+    size_t compressWords(Dict& dict, const uint8_t* src, size_t src_size,
+                         uint8_t* dst, size_t dst_capacity);
+    template <typename Dict>
+    size_t decompressWords(Dict& dict, const uint8_t* src, size_t src_size,
+                           uint8_t* dst, size_t dst_capacity);
+    // encode the src_size / WORD_SIZE whole words of src
+    template <typename Dict>
+    void encodeWords(Dict& dict, const uint8_t* src, size_t src_size, BitWriter& out);
+    // encode a trailing partial word of size (< WORD_SIZE) bytes
+    void encodeTail(const uint8_t* src, size_t size, BitWriter& out) const;
+    template <typename Dict>
+    void updateWords(Dict& dict, const uint8_t* src, size_t src_size, BitWriter& out);
+    template <typename Dict>
+    Compressed2Word compress2Word(Dict& dict, const uint32_t& data);
+    void encode2Word(const Compressed2Word& block, BitWriter& out) const;
+    // decode one code into dst, return the number of bytes written
+    template <typename Dict>
+    size_t decompress2Word(Dict& dict, BitReader& in, uint8_t* dst);
+    // length in bits of the code starting at the reader, 0 at the end of
+    // the stream; partial is set to the byte count of a trailing partial word
+    size_t codeLength(BitReader& in, size_t& partial) const;
+
+    FixedDictionary<FLAT_DICT_ENTRIES> flat_dict_;
     Dictionary dict_;
+    bool use_flat_dict_;
+    unsigned index_bits_;
+
+    // streaming state
+    BitWriter::State stream_bits_;
+    uint8_t stream_tail_[WORD_SIZE];
+    size_t stream_tail_size_ = 0;
 };
 
 } // namespace compression
 
-#endif // CPACK_H 
\ No newline at end of file
+#endif // CPACK_H
@@ -12,8 +12,25 @@ public:
     FPC();
     ~FPC() override = default;
 
-    std::vector<uint8_t> compress(const std::vector<uint8_t>& data) override;
-    std::vector<uint8_t> decompress(const std::vector<uint8_t>& compressed_data) override;
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override;
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    // FPC works on 4-byte words; a compressed word is a pattern byte
+    // followed by at most one word of payload
+    static constexpr size_t WORD_SIZE = 4;
+    static constexpr size_t MAX_BLOCK_SIZE = 1 + WORD_SIZE;
+
+protected:
+    size_t streamUnit() const override {
+        return WORD_SIZE;
+    }
 
 private:
     static constexpr uint8_t ZERO = 0x00;
@@ -22,14 +39,13 @@ private:
     static constexpr uint8_t UNCOMPRESSED = 0x03;
     static constexpr uint8_t HALF_PRECISION = 0x04;
     
-    struct CompressedBlock {
-        uint8_t pattern;
-        std::vector<uint8_t> data;
-    };
-
-    CompressedBlock compressBlock(const std::vector<uint8_t>& data, size_t offset);
-    std::vector<uint8_t> decompressBlock(const std::vector<uint8_t>& data, size_t& offset);
-    uint8_t detectPattern(const std::vector<uint8_t>& data, size_t offset);
+    // encode a word of size bytes into dst, return the compressed size
+    size_t compressBlock(const uint8_t* word, size_t size, uint8_t* dst);
+    // decode the block at src[offset] into dst, advance offset and
+    // return the number of bytes written
+    size_t decompressBlock(const uint8_t* src, size_t src_size, size_t& offset,
+                           uint8_t* dst, size_t dst_capacity);
+    uint8_t detectPattern(const uint8_t* word, size_t size);
 };
 
 } // namespace compression
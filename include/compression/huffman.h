@@ -1,34 +1,174 @@
 // huffman compression algorithm in cpp
+#ifndef HUFFMAN_H
+#define HUFFMAN_H
+
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
-#include <queue>
-#include <unordered_map>
-#include <vector>
 #include <string>
+#include <vector>
+#include "compression_base.h"
 
-struct HuffmanNode {
-    char data;
-    unsigned frequency;
-    HuffmanNode *left, *right;
-    
-    HuffmanNode(char data, unsigned freq) : data(data), frequency(freq), left(nullptr), right(nullptr) {}
-};
-
-struct CompareNodes {
-    bool operator()(HuffmanNode* a, HuffmanNode* b) {
-        return a->frequency > b->frequency;
-    }
-};
+// codes are at most this long, the decoder resolves every symbol with one
+// lookup in a table of 1 << HUF_MAX_CODE_LENGTH entries
+constexpr int HUF_MAX_CODE_LENGTH = 11;
+constexpr int HUF_NUM_SYMBOLS = 256;
 
+// Byte-oriented canonical Huffman coder.
+//
+// Output, little endian:
+//   uint32 original size, uint8 mode, then by mode
+//   RAW:     the input bytes, used when coding does not shrink the input
+//   RLE:     the one byte value the input repeats
+//   HUFFMAN: the code table, then the coded symbols
+// A code table is uint8 largest symbol and the code length of every symbol
+// up to it in 4 bits (low nibble first). Only the lengths are stored:
+// codes are canonical, so the decoder rebuilds them by assigning
+// consecutive values in (length, symbol) order.
+//
+// Symbols are coded MSB first, each stream padded with zero bits to a
+// byte. Inputs of FOUR_STREAM_MIN bytes or more are cut into 4 segments of
+// (size + 3) / 4 bytes, the last one taking the rest, each coded as its own
+// stream after a jump table of the first three stream sizes as uint32, so
+// the decoder can run the four streams' lookups side by side.
+//
+// Every output carries its own table, so any instance decodes it. For many
+// small blocks with the same statistics a shared table can be built once,
+// shipped with writeTable and loaded with readTable on the decoding side;
+// compressWithTable then writes only the uint32 size and the bitstream.
 class HuffmanCompression {
-private:
-    HuffmanNode* root = nullptr;
-    std::unordered_map<char, std::string> huffmanCodes;
-    void generateCodes(HuffmanNode* root, std::string code);
-    
 public:
+    enum Mode : uint8_t {
+        RAW = 0,
+        RLE = 1,
+        HUFFMAN = 2
+    };
+
+    static constexpr size_t HEADER_SIZE = 5;
+    static constexpr size_t FOUR_STREAM_MIN = 1024;
+    static constexpr size_t JUMP_TABLE_SIZE = 12;
+    // largest serialized code table
+    static constexpr size_t MAX_TABLE_SIZE = 1 + HUF_NUM_SYMBOLS / 2;
+
+    // Buffer interface, returns the bytes written and throws
+    // std::runtime_error if dst is too small or src is malformed
+    size_t compress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity);
+    size_t decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity);
+
+    static size_t maxCompressedSize(size_t src_size) {
+        return src_size + HEADER_SIZE;
+    }
+    static size_t decompressedSize(const uint8_t* src, size_t src_size);
+
     std::string compress(const std::string& input);
     std::string decompress(const std::string& compressed);
-    HuffmanNode* buildTree(const std::string& input);
+
+    // Shared table built from sample data. Every byte value gets a code,
+    // so any input can be coded with it, at some cost for values the
+    // samples lack.
+    void buildTable(const uint8_t* sample, size_t sample_size);
+    // serialize the shared table, at most MAX_TABLE_SIZE bytes
+    size_t writeTable(uint8_t* dst, size_t dst_capacity) const;
+    // load a table written by writeTable, return the bytes read
+    size_t readTable(const uint8_t* src, size_t src_size);
+    bool hasTable() const {
+        return table_.ready;
+    }
+
+    // Code with the shared table; the output is 4 bytes of size and a
+    // bitstream, at most maxTableCompressedSize(src_size) bytes
+    size_t compressWithTable(const uint8_t* src, size_t src_size,
+                             uint8_t* dst, size_t dst_capacity) const;
+    size_t decompressWithTable(const uint8_t* src, size_t src_size,
+                               uint8_t* dst, size_t dst_capacity) const;
+    static size_t maxTableCompressedSize(size_t src_size) {
+        // every stream pads up to a byte
+        return 4 + JUMP_TABLE_SIZE + src_size * HUF_MAX_CODE_LENGTH / 8 + 4;
+    }
+
+    // print the codes of the last compress
     void printout();
-    void removeTree();
+
+private:
+    struct DecodeEntry {
+        uint8_t symbol;
+        uint8_t length;
+    };
+
+    // a canonical code and its decoding table
+    struct Code {
+        uint8_t lengths[HUF_NUM_SYMBOLS] = {};
+        uint16_t codes[HUF_NUM_SYMBOLS] = {};
+        // indexed by the next HUF_MAX_CODE_LENGTH bits of the stream
+        std::vector<DecodeEntry> decodeTable;
+        int maxSymbol = -1;
+        bool ready = false;
+
+        // lengths from frequencies, then codes; the decoding table is
+        // built separately since compress does not need it
+        void build(const uint32_t* frequencies);
+        // the serialized lengths at src, then codes and the decoding table
+        size_t read(const uint8_t* src, size_t src_size);
+        size_t write(uint8_t* dst, size_t dst_capacity) const;
+        size_t tableSize() const {
+            return 1 + (maxSymbol + 2) / 2;
+        }
+
+        void buildCodes();
+        void buildDecodeTable();
+    };
+
+    // code lengths of a Huffman code over the frequencies, none longer
+    // than HUF_MAX_CODE_LENGTH; unused symbols get 0
+    static void buildLengths(const uint32_t* frequencies, uint8_t* lengths);
+
+    // bytes of every stream of src_size symbols, returns their total
+    // including the jump table
+    static size_t streamBytes(const Code& code, const uint8_t* src, size_t src_size,
+                              size_t* stream_bytes);
+    static uint8_t* encodeStream(const Code& code, const uint8_t* src, size_t src_size,
+                                 uint8_t* dst, uint8_t* dst_end);
+    static uint8_t* encodeSymbols(const Code& code, const uint8_t* src, size_t src_size,
+                                  const size_t* stream_bytes, uint8_t* dst, uint8_t* dst_end);
+    // decode a stream from ip with used bits of its first byte consumed
+    static void decodeStream(const DecodeEntry* table, const uint8_t* ip, unsigned used,
+                             const uint8_t* src_end, uint8_t* op, uint8_t* oend);
+    static void decodeSymbols(const Code& code, const uint8_t* src, const uint8_t* src_end,
+                              uint8_t* dst, size_t size);
+
+    // the code of the last compress or decompress
+    Code code_;
+    // the shared table of buildTable and readTable
+    Code table_;
 };
+
+namespace compression {
+
+// CompressionBase adapter over HuffmanCompression, so Huffman can be used
+// wherever the other codecs are, e.g. in ParallelCompressor
+class HuffmanCodec : public CompressionBase {
+public:
+    HuffmanCodec() = default;
+    ~HuffmanCodec() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override {
+        return HuffmanCompression::maxCompressedSize(src_size);
+    }
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override {
+        return HuffmanCompression::decompressedSize(src, src_size);
+    }
+
+private:
+    HuffmanCompression huffman_;
+};
+
+} // namespace compression
+
+#endif // HUFFMAN_H
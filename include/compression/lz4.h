@@ -7,27 +7,121 @@
 #include <cstring>
 #include <cassert>
 #include <algorithm>
+#include <memory>
+#include "compression_base.h"
 
 #define MIN(x,y) (std::min(static_cast<size_t>(x), static_cast<size_t>(y)))
 
-const int MAGIC_NUMBER = 0x9E3779B9;
-const int HASH_TABLE_SIZE = 65536;
+// Knuth's multiplicative hash constant, applied to 4-byte sequences
+constexpr uint32_t MAGIC_NUMBER = 2654435761u;
+constexpr int HASH_LOG = 16;
+const int HASH_TABLE_SIZE = 1 << HASH_LOG;
 constexpr int LZ4_MIN_MATCH = 4;
 constexpr int LZ4_MAX_DISTANCE = 65535;
 const int WINDOW_SIZE = 64 * 1024; // 64 KB
+// candidates the HC mode tries per position by default
+constexpr int LZ4_HC_DEFAULT_ATTEMPTS = 64;
+// block format limits: the last 5 bytes are always literals and the last
+// match starts at least 12 bytes before the end
+constexpr int LZ4_LAST_LITERALS = 5;
+constexpr int LZ4_MF_LIMIT = 12;
+// positions are stored as int
+constexpr size_t LZ4_MAX_INPUT_SIZE = 0x7E000000;
+// compressSmall: 16-bit positions, and a table of at most
+// 1 << LZ4_SMALL_HASH_LOG entries on the stack
+constexpr size_t LZ4_SMALL_MAX_INPUT = 65535;
+constexpr int LZ4_SMALL_HASH_LOG = 12;
 
 
 class LZ4Compressor {
 private:
 
-    // hash table initialized with -1
-    int hashTable[HASH_TABLE_SIZE] = {-1}; // Stores positions of sequences
+    // last position of every hashed 4-byte sequence plus tableOffset_.
+    // Each call starts a new generation by moving tableOffset_ past every
+    // value stored so far, so older entries read as empty without clearing
+    // the table. It is cleared only when the offsets run out.
+    uint32_t hashTable[HASH_TABLE_SIZE];
+    uint32_t tableOffset_ = 1;
+    // above every value in hashTable
+    uint32_t tableEnd_ = 1;
+    int acceleration_;
+
+public:
+    // FAST takes the first match of a single-candidate hash table, HC
+    // walks a hash chain over the window for the longest match and parses
+    // lazily. Both produce the same block format.
+    enum class Mode {
+        FAST,
+        HC
+    };
+
+private:
+    Mode mode_ = Mode::FAST;
+    int max_attempts_ = LZ4_HC_DEFAULT_ATTEMPTS;
+    // HC only: distance to the previous position with the same hash,
+    // indexed by position modulo WINDOW_SIZE, 0 ends the chain
+    std::unique_ptr<uint16_t[]> chainTable_;
+    // next position the HC chains have not seen yet
+    size_t nextToInsert_ = 0;
+
+    // loaded dictionary followed by room for the input, and the hash
+    // table primed with the dictionary alone
+    std::vector<uint8_t> dictBuffer_;
+    size_t dictSize_ = 0;
+    std::unique_ptr<uint32_t[]> dictTable_;
+    // hashTable equals dictTable_
+    bool tableHoldsDictionary_ = false;
+    // HC chains over the dictionary alone, their hash table is dictTable_
+    std::unique_ptr<uint16_t[]> dictChain_;
+    // chainTable_ equals dictChain_
+    bool chainHoldsDictionary_ = false;
+
+    // start a generation for span positions, clearing the table if the
+    // offsets would overflow
+    void resetTable(size_t span);
+
+    // compress the src_size bytes at base + start, the start bytes before
+    // them are history; table positions are relative to base. Positions
+    // below chained are already in the chains.
+    size_t compressHC(const uint8_t* base, size_t start, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity, size_t chained);
+    // insert every position up to pos into the chains, then return the
+    // longest match at pos within limit, 0 if there is none
+    size_t findBestMatchHC(const uint8_t* base, size_t pos, const uint8_t* limit,
+                           const uint8_t*& match);
+
 public:
-    LZ4Compressor() {
-        // initialize the hash table with -1
-        std::fill(hashTable, hashTable + HASH_TABLE_SIZE, -1);
+    // acceleration > 1 trades ratio for speed by probing fewer positions
+    // on data that does not match
+    explicit LZ4Compressor(int acceleration = 1) : acceleration_(std::max(1, acceleration)) {
+        // zero is below every offset
+        std::fill(hashTable, hashTable + HASH_TABLE_SIZE, 0);
     }
+
+    void setAcceleration(int acceleration) {
+        acceleration_ = std::max(1, acceleration);
+    }
+
+    void setMode(Mode mode) {
+        mode_ = mode;
+    }
+
+    // chain candidates HC compares per position, more is slower and
+    // finds longer matches
+    void setMaxAttempts(int max_attempts) {
+        max_attempts_ = std::max(1, max_attempts);
+    }
+
 public:
+    /*
+     * A compressed block is a sequence of
+     *   token: literal length (high 4 bits), match length - 4 (low 4 bits)
+     *   literal length - 15 in 255-byte steps if the nibble is 15
+     *   literals
+     *   match offset, 2 bytes little endian
+     *   match length - 19 in 255-byte steps if the nibble is 15
+     * and ends with a sequence of literals only, as in the LZ4 block format.
+     */
     struct LZ4Block {
         // 1 bytes
         uint8_t token;
@@ -43,7 +137,7 @@ public:
         // print the block
         void print() {
             std::cout << "Token: " << static_cast<int>(token) << std::endl;
-            int literalLength = token & 0xF;
+            int literalLength = token >> 4;
             for (auto& literal : literalLengths) {
                 literalLength += literal;
             }
@@ -55,7 +149,7 @@ public:
             }
             std::cout << std::endl;
             std::cout << "Match Offset: " << matchOffset << std::endl;
-            int matchLength = ((token >> 4) & 0xF) + 4;
+            int matchLength = (token & 0xF) + 4;
             for (auto& match : matchLengths) {
                 matchLength += match;
             }
@@ -64,14 +158,12 @@ public:
 
         // encode the block
         void encode(std::vector<char>& output) {
-            // count increased size of output
-            int originalSize = output.size();
             // encode the token
             output.push_back(token);
             // encode the literal lengths
             for (auto& literal : literalLengths) {
                 output.push_back(literal);
-            }   
+            }
             // encode the literals
             for (auto& literal : literals) {
                 output.push_back(literal);
@@ -83,35 +175,37 @@ public:
             for (auto& match : matchLengths) {
                 output.push_back(match);
             }
-
-        }   
-    };
-
-    // hash function
-    int hashFunction(const char* data, size_t index, size_t length) {
-        int64_t hash_value = 0;
-        for (int i = 0; i < MIN(length - index, 4); ++i) {
-            hash_value = (hash_value << 8) + data[index + i];
         }
+    };
 
-        hash_value = hash_value ^ MAGIC_NUMBER;
-
-        int hash_value_positive = hash_value % HASH_TABLE_SIZE;
-        // ensure hash_value is positive
-        if (hash_value_positive < 0) {
-            hash_value_positive = -hash_value_positive;
-        }
-        return hash_value_positive;
+    // hash of the 4-byte sequence at data
+    static uint32_t hashFunction(const uint8_t* data) {
+        uint32_t sequence;
+        std::memcpy(&sequence, data, 4);
+        return (sequence * MAGIC_NUMBER) >> (32 - HASH_LOG);
     }
 
-    // find the match length
-    int findMatchLength(const char* data, size_t dataSize, size_t currentIndex, size_t candidateIndex) {
-        int matchLength = 0;
-        while ((currentIndex + matchLength < dataSize && data[currentIndex + matchLength] == data[candidateIndex + matchLength]) && 
-        (candidateIndex + matchLength < currentIndex)) {
-            matchLength++;
+    // number of equal bytes at current and candidate, not reading at or
+    // past limit; compares 8 bytes at a time
+    static size_t findMatchLength(const uint8_t* current, const uint8_t* candidate,
+                                  const uint8_t* limit) {
+        const uint8_t* start = current;
+        while (current + 8 <= limit) {
+            uint64_t a, b;
+            std::memcpy(&a, current, 8);
+            std::memcpy(&b, candidate, 8);
+            if (uint64_t diff = a ^ b) {
+                // first differing byte on a little endian load
+                return current - start + (__builtin_ctzll(diff) >> 3);
+            }
+            current += 8;
+            candidate += 8;
+        }
+        while (current < limit && *current == *candidate) {
+            current++;
+            candidate++;
         }
-        return matchLength;
+        return current - start;
     }
 
     void printOutput(const std::vector<char>& output) {
@@ -121,8 +215,86 @@ public:
         std::cout << std::endl;
     }
 
+    // Largest block compress can produce for src_size input bytes
+    static size_t compressBound(size_t src_size) {
+        return src_size + src_size / 255 + 16;
+    }
+
+    // Buffer interface, returns the bytes written and throws
+    // std::runtime_error if dst is too small or src is malformed
+    size_t compress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity);
+    static size_t decompress(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity);
+
+    // Fast mode without an instance, for inputs up to LZ4_SMALL_MAX_INPUT
+    // when no compressor is at hand: the table lives on the stack and is
+    // sized to the input, so setup is a few hundred bytes of clearing for
+    // small messages. A reused instance needs no clearing at all.
+    static size_t compressSmall(const uint8_t* src, size_t src_size,
+                                uint8_t* dst, size_t dst_capacity, int acceleration = 1);
+
+    // Linked blocks: matches may reach into the prefix_size bytes right
+    // before src (at most WINDOW_SIZE are used), and the decoder needs the
+    // same bytes right before dst
+    size_t compressWithPrefix(const uint8_t* src, size_t src_size,
+                              uint8_t* dst, size_t dst_capacity, size_t prefix_size);
+    static size_t decompressWithPrefix(const uint8_t* src, size_t src_size,
+                                       uint8_t* dst, size_t dst_capacity, size_t prefix_size);
+
+    // Shared dictionary for small records: its last WINDOW_SIZE bytes act
+    // as history of every compressWithDictionary input. The hash table and
+    // the HC chains are primed once here and restored cheaply after each
+    // call.
+    void loadDictionary(const uint8_t* dict, size_t dict_size);
+    size_t compressWithDictionary(const uint8_t* src, size_t src_size,
+                                  uint8_t* dst, size_t dst_capacity);
+    // decode with the same dictionary, which need not be next to dst
+    static size_t decompressWithDictionary(const uint8_t* src, size_t src_size,
+                                           uint8_t* dst, size_t dst_capacity,
+                                           const uint8_t* dict, size_t dict_size);
+
+    // Build a dictionary of at most dict_size bytes from sample records,
+    // out of the segments shared by the most samples
+    static std::vector<uint8_t> trainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                                size_t dict_size = WINDOW_SIZE);
+    // Exact size of the data encoded in a block
+    static size_t decompressedSize(const uint8_t* src, size_t src_size);
+
     std::vector<char> compress(const std::vector<char>& input);
     std::vector<char> decompress(const std::vector<char>& input);
 };
 
+namespace compression {
+
+// CompressionBase adapter over LZ4Compressor, so LZ4 can be used wherever
+// the other codecs are, e.g. in ParallelCompressor
+class LZ4Codec : public CompressionBase {
+public:
+    explicit LZ4Codec(int acceleration = 1) : lz4_(acceleration) {}
+    ~LZ4Codec() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override {
+        return LZ4Compressor::compressBound(src_size);
+    }
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override {
+        return LZ4Compressor::decompressedSize(src, src_size);
+    }
+
+    // to change the mode or acceleration
+    LZ4Compressor& compressor() {
+        return lz4_;
+    }
+
+private:
+    LZ4Compressor lz4_;
+};
+
+} // namespace compression
+
 #endif // LZ4_H
@@ -0,0 +1,122 @@
+#ifndef LZ4_FRAME_H
+#define LZ4_FRAME_H
+
+#include "compression_base.h"
+#include "lz4.h"
+#include "thread_pool.h"
+#include <vector>
+#include <cstdint>
+
+namespace compression {
+
+// LZ4 frame format, readable and writable by the stock lz4 tools:
+//   magic 0x184D2204, FLG, BD, [content size], header checksum,
+//   blocks of [uint32 size, bit 31 set if stored raw][data][block checksum],
+//   uint32 0 end mark, [content checksum]
+// Checksums are xxHash32. Blocks are compressed with LZ4Compressor, linked
+// blocks may match into the 64 KB before them.
+class LZ4Frame : public CompressionBase {
+public:
+    static constexpr uint32_t MAGIC = 0x184D2204;
+    static constexpr uint32_t STORED_BLOCK = 0x80000000u;
+
+    // block maximum size, the BD byte's size id
+    enum class BlockSize {
+        KB64 = 4,
+        KB256 = 5,
+        MB1 = 6,
+        MB4 = 7
+    };
+
+    // Where a block sits in a frame and in the decompressed data
+    struct BlockInfo {
+        size_t offset;              // of the block data in the frame
+        size_t size;                // of the block data
+        bool stored;                // kept uncompressed
+        size_t decompressed_offset;
+        size_t decompressed_size;
+    };
+
+    LZ4Frame() = default;
+    ~LZ4Frame() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override;
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    // Defaults follow the lz4 command line tool: 4 MB independent blocks
+    // and a content checksum
+    void setBlockSize(BlockSize block_size) {
+        block_size_ = block_size;
+    }
+
+    void setBlockIndependence(bool independent) {
+        independent_ = independent;
+    }
+
+    void setContentSize(bool content_size) {
+        content_size_ = content_size;
+    }
+
+    void setContentChecksum(bool content_checksum) {
+        content_checksum_ = content_checksum;
+    }
+
+    void setBlockChecksum(bool block_checksum) {
+        block_checksum_ = block_checksum;
+    }
+
+    // decompress independent blocks in parallel on pool, nullptr for serial
+    void setThreadPool(ThreadPool* pool) {
+        pool_ = pool;
+    }
+
+    // to change the LZ4 mode or acceleration
+    LZ4Compressor& compressor() {
+        return lz4_;
+    }
+
+    static size_t blockMaxSize(BlockSize block_size) {
+        return size_t(1) << (8 + 2 * static_cast<int>(block_size));
+    }
+
+    // Locate every block of a frame, verifying the header and block
+    // checksums; the decompressed sizes are read from the blocks
+    std::vector<BlockInfo> blockIndex(const uint8_t* src, size_t src_size) const;
+
+    // Decompress one block of a frame with independent blocks into dst,
+    // which needs block.decompressed_size bytes
+    size_t decompressBlock(const uint8_t* src, size_t src_size, const BlockInfo& block,
+                           uint8_t* dst, size_t dst_capacity) const;
+
+private:
+    struct Header {
+        size_t size;                // of the frame header
+        bool independent;
+        bool block_checksum;
+        bool content_checksum;
+        bool has_content_size;
+        uint64_t content_size;
+        size_t block_max_size;
+    };
+
+    Header readHeader(const uint8_t* src, size_t src_size) const;
+
+    BlockSize block_size_ = BlockSize::MB4;
+    bool independent_ = true;
+    bool content_size_ = false;
+    bool content_checksum_ = true;
+    bool block_checksum_ = false;
+    ThreadPool* pool_ = nullptr;
+    LZ4Compressor lz4_;
+};
+
+} // namespace compression
+
+#endif // LZ4_FRAME_H
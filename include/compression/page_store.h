@@ -0,0 +1,86 @@
+#ifndef PAGE_STORE_H
+#define PAGE_STORE_H
+
+#include "compression_base.h"
+#include "thread_pool.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace compression {
+
+// Compressed memory of 4 KB pages with random-access line reads. Every
+// page is coded as 64 independent lines with a line codec's compressLines,
+// and the page keeps the offset of each line in its payload, so reading one
+// line decodes only that line. A line the codec does not shrink is kept
+// raw. Pages never written read as zeros.
+//
+// writePages compresses a batch of pages on a ThreadPool, one codec per
+// worker; with one thread everything runs on the caller and no pool is
+// created. The store itself is not thread safe.
+class PageStore {
+public:
+    using CodecFactory = std::function<std::unique_ptr<CompressionBase>()>;
+
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t LINE_SIZE = CompressionBase::LINE_SIZE;
+    static constexpr size_t LINES_PER_PAGE = PAGE_SIZE / LINE_SIZE;
+
+    // num_pages pages with codecs from factory; num_threads 0 uses every
+    // hardware thread for writePages, 1 runs it inline
+    PageStore(CodecFactory factory, size_t num_pages, size_t num_threads = 1);
+
+    PageStore(const PageStore&) = delete;
+    PageStore& operator=(const PageStore&) = delete;
+
+    // write PAGE_SIZE bytes of src to page
+    void writePage(size_t page, const uint8_t* src);
+    // write num_pages consecutive pages of src starting at first_page
+    void writePages(size_t first_page, const uint8_t* src, size_t num_pages);
+
+    // read LINE_SIZE bytes of line (0..63) of page into dst
+    void readLine(size_t page, size_t line, uint8_t* dst);
+    // read PAGE_SIZE bytes of page into dst
+    void readPage(size_t page, uint8_t* dst);
+
+    size_t numPages() const {
+        return pages_.size();
+    }
+
+    // stored bytes of a page and of one of its lines, 0 if never written
+    size_t compressedSize(size_t page) const;
+    size_t lineCompressedSize(size_t page, size_t line) const;
+    // stored bytes of all pages
+    size_t totalCompressedSize() const {
+        return total_size_;
+    }
+
+private:
+    struct Page {
+        std::vector<uint8_t> payload;
+        // line i is payload[offsets[i], offsets[i + 1])
+        uint16_t offsets[LINES_PER_PAGE + 1] = {};
+        CompressionBase::LineRecord records[LINES_PER_PAGE] = {};
+        // bit i set if line i is stored raw
+        uint64_t raw_lines = 0;
+        bool written = false;
+    };
+
+    // compress src into page with codec, staging the lines in scratch
+    void encodePage(CompressionBase& codec, std::vector<uint8_t>& scratch,
+                    const uint8_t* src, Page& page);
+    const Page& at(size_t page) const;
+
+    std::vector<Page> pages_;
+    size_t total_size_ = 0;
+    // codecs_[i] and scratch_[i] belong to stripe i of writePages, index 0
+    // also serves the single page calls
+    std::vector<std::unique_ptr<CompressionBase>> codecs_;
+    std::vector<std::vector<uint8_t>> scratch_;
+    // only with more than one thread
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace compression
+
+#endif // PAGE_STORE_H
@@ -0,0 +1,77 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "compression_base.h"
+#include "thread_pool.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace compression {
+
+// Chunked driver that compresses a buffer as independent chunks on a
+// ThreadPool with any CompressionBase codec.
+//
+// Layout, little endian:
+//   uint32 magic, uint32 chunk size, uint64 original size,
+//   uint32 per chunk: compressed size, STORED_CHUNK set if kept raw,
+//   chunk payloads back to back.
+// The index gives every chunk's offset, so decompression runs in parallel
+// too. A chunk that does not shrink is stored raw.
+class ParallelCompressor : public CompressionBase {
+public:
+    using CodecFactory = std::function<std::unique_ptr<CompressionBase>()>;
+
+    static constexpr uint32_t MAGIC = 0x4B484350;   // "PCHK"
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+    static constexpr uint32_t STORED_CHUNK = 0x80000000u;
+
+    // factory creates one codec per concurrently running chunk; chunk_size
+    // must be below 2 GB. num_threads 0 uses every hardware thread.
+    explicit ParallelCompressor(CodecFactory factory,
+                                size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                                size_t num_threads = 0);
+    ~ParallelCompressor() override = default;
+
+    using CompressionBase::compress;
+    using CompressionBase::decompress;
+
+    // chunks are compressed in place at their worst case offsets and then
+    // packed, so dst_capacity must be at least maxCompressedSize(src_size)
+    size_t compress(const uint8_t* src, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) override;
+    size_t decompress(const uint8_t* src, size_t src_size,
+                      uint8_t* dst, size_t dst_capacity) override;
+    size_t maxCompressedSize(size_t src_size) const override;
+    size_t decompressedSize(const uint8_t* src, size_t src_size) const override;
+
+    size_t chunkSize() const {
+        return chunk_size_;
+    }
+
+    size_t numThreads() const {
+        return pool_.size();
+    }
+
+private:
+    // largest output of one chunk of size bytes
+    size_t chunkBound(size_t size) const;
+    // borrow a codec from the free list, creating one if it is empty
+    std::unique_ptr<CompressionBase> acquire();
+    void release(std::unique_ptr<CompressionBase> codec);
+
+    CodecFactory factory_;
+    // answers maxCompressedSize, which is const
+    std::unique_ptr<CompressionBase> bound_codec_;
+    size_t chunk_size_;
+    ThreadPool pool_;
+
+    std::mutex codecs_mutex_;
+    std::vector<std::unique_ptr<CompressionBase>> codecs_;
+};
+
+} // namespace compression
+
+#endif // PARALLEL_H
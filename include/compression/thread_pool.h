@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace compression {
+
+// Work-stealing thread pool. Every worker owns a task queue, takes work
+// from the back of its own queue and steals from the front of the others
+// when it runs dry. Tasks pushed from a worker go to that worker's queue,
+// tasks from other threads are spread round robin.
+class ThreadPool {
+public:
+    // num_threads 0 uses one worker per hardware thread
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers_.size();
+    }
+
+    // Run fn(i) for every i in [0, count) and wait for all of them. The
+    // calling thread runs tasks too while it waits. The first exception
+    // thrown by fn is rethrown once every task has finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    // own queue first, then steal; self == size() for non-worker threads
+    bool pop(size_t self, Task& task);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_queue_{0};
+    bool stop_ = false;
+};
+
+} // namespace compression
+
+#endif // THREAD_POOL_H
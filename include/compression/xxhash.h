@@ -0,0 +1,14 @@
+#ifndef XXHASH_H
+#define XXHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace compression {
+
+// 32-bit xxHash of size bytes, as used by the LZ4 frame format
+uint32_t xxhash32(const uint8_t* data, size_t size, uint32_t seed = 0);
+
+} // namespace compression
+
+#endif // XXHASH_H
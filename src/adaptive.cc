@@ -0,0 +1,342 @@
+// src/adaptive.cc
+#include "compression/adaptive.h"
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ADAPTIVE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace compression {
+
+namespace {
+
+constexpr size_t LINE_SIZE = CompressionBase::LINE_SIZE;
+constexpr size_t LINE_WORDS = LINE_SIZE / 4;
+// room for any codec's output of a line, FPC's worst case is 80 bytes
+constexpr size_t SCRATCH_SIZE = 2 * LINE_SIZE;
+// FPC spends at least a byte and CPack two bits on a word, neither codes a
+// line in fewer bytes
+constexpr size_t MIN_PREDICTED_SIZE = LINE_WORDS * 2 / 8;
+
+// CPack pattern of word i of a line, from bitmaps of the line's words equal
+// to it in all 4 bytes, in the upper 3 and in the upper 2. CPack starts
+// every compress with an empty dictionary that holds all 16 words of a
+// line, so a word matches when an earlier word that went to the dictionary
+// shares its prefix; in_dict is the bitmap of those words.
+inline uint8_t cpackPattern(size_t i, uint32_t word, uint16_t equal, uint16_t upper3,
+                            uint16_t upper2, uint16_t& in_dict) {
+    if ((word & 0xFFFFFF00) == 0) {
+        return word == 0 ? CPack::ZERO_PATTERN : CPack::ZERO_UNMATCH;
+    }
+    if (equal & in_dict) {
+        return CPack::MATCH_DICT;
+    }
+    uint8_t pattern = upper3 & in_dict ? CPack::PARTIAL_MATCH_3B
+                    : upper2 & in_dict ? CPack::PARTIAL_MATCH_2B
+                    : CPack::NONE_MATCH;
+    in_dict |= uint16_t(1) << i;
+    return pattern;
+}
+
+// The CPack patterns of the 16 words of a line
+using PatternFn = void (*)(const uint32_t* words, uint8_t* patterns);
+
+void cpackPatternsScalar(const uint32_t* words, uint8_t* patterns) {
+    uint16_t in_dict = 0;
+    for (size_t i = 0; i < LINE_WORDS; i++) {
+        uint16_t equal = 0;
+        uint16_t upper3 = 0;
+        uint16_t upper2 = 0;
+        for (size_t j = 0; j < i; j++) {
+            uint32_t diff = words[i] ^ words[j];
+            equal |= uint16_t(diff == 0) << j;
+            upper3 |= uint16_t(diff < 0x100) << j;
+            upper2 |= uint16_t(diff < 0x10000) << j;
+        }
+        patterns[i] = cpackPattern(i, words[i], equal, upper3, upper2, in_dict);
+    }
+}
+
+#if defined(ADAPTIVE_X86)
+
+// bitmap of the zero lanes of two vectors of 8 words
+__attribute__((target("avx2")))
+inline uint16_t zeroBitsAVX2(__m256i low, __m256i high) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t bits_low = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(low, zero)));
+    uint32_t bits_high = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(high, zero)));
+    return static_cast<uint16_t>(bits_low | bits_high << 8);
+}
+
+__attribute__((target("avx2")))
+void cpackPatternsAVX2(const uint32_t* words, uint8_t* patterns) {
+    const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words));
+    const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + 8));
+    const __m256i mask3 = _mm256_set1_epi32(static_cast<int>(0xFFFFFF00));
+    const __m256i mask2 = _mm256_set1_epi32(static_cast<int>(0xFFFF0000));
+    uint16_t in_dict = 0;
+    for (size_t i = 0; i < LINE_WORDS; i++) {
+        const __m256i word = _mm256_set1_epi32(static_cast<int>(words[i]));
+        const __m256i a = _mm256_xor_si256(lo, word);
+        const __m256i b = _mm256_xor_si256(hi, word);
+        patterns[i] = cpackPattern(
+            i, words[i], zeroBitsAVX2(a, b),
+            zeroBitsAVX2(_mm256_and_si256(a, mask3), _mm256_and_si256(b, mask3)),
+            zeroBitsAVX2(_mm256_and_si256(a, mask2), _mm256_and_si256(b, mask2)), in_dict);
+    }
+}
+
+// the line fits one register, each bitmap is one test
+__attribute__((target("avx512f")))
+void cpackPatternsAVX512(const uint32_t* words, uint8_t* patterns) {
+    const __m512i line = _mm512_loadu_si512(words);
+    const __m512i mask3 = _mm512_set1_epi32(static_cast<int>(0xFFFFFF00));
+    const __m512i mask2 = _mm512_set1_epi32(static_cast<int>(0xFFFF0000));
+    uint16_t in_dict = 0;
+    for (size_t i = 0; i < LINE_WORDS; i++) {
+        const __m512i diff = _mm512_xor_si512(line, _mm512_set1_epi32(static_cast<int>(words[i])));
+        patterns[i] = cpackPattern(i, words[i], _mm512_testn_epi32_mask(diff, diff),
+                                   _mm512_testn_epi32_mask(diff, mask3),
+                                   _mm512_testn_epi32_mask(diff, mask2), in_dict);
+    }
+}
+
+PatternFn patternKernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return cpackPatternsAVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return cpackPatternsAVX2;
+    }
+    return cpackPatternsScalar;
+}
+
+#else
+
+PatternFn patternKernel() {
+    return cpackPatternsScalar;
+}
+
+#endif
+
+// Exact FPC and CPack sizes of a line. FPC codes every word on its own,
+// the CPack patterns come from the kernel for the running CPU.
+void predictSizes(const CPack& cpack, const uint8_t* line,
+                  size_t& fpc_size, size_t& cpack_size) {
+    static const PatternFn cpack_patterns = patternKernel();
+
+    uint32_t words[LINE_WORDS];
+    std::memcpy(words, line, LINE_SIZE);
+    uint8_t patterns[LINE_WORDS];
+    cpack_patterns(words, patterns);
+
+    size_t fpc_bytes = 0;
+    size_t cpack_bits = 0;
+    for (size_t i = 0; i < LINE_WORDS; i++) {
+        // a pattern byte, then nothing, one byte, the low half or the word
+        uint32_t word = words[i];
+        uint32_t zero = word == 0;
+        uint32_t repeated = word == (word & 0xFF) * 0x01010101u;
+        uint32_t half = (word >> 16) == 0;
+        fpc_bytes += 5 - 2 * half - 3 * repeated + zero;
+        cpack_bits += cpack.getCompBlkSize(patterns[i]);
+    }
+
+    fpc_size = fpc_bytes;
+    cpack_size = (cpack_bits + 7) / 8;
+}
+
+void storeSize(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+} // namespace
+
+Adaptive::Adaptive(uint8_t enabled) : enabled_(enabled & ENABLE_ALL) {}
+
+Adaptive::Selector Adaptive::compressLine(const uint8_t* line, uint8_t* dst, size_t& size) {
+    // the best output so far stays in one scratch buffer, the next
+    // attempt goes to the other
+    uint8_t scratch[2][SCRATCH_SIZE];
+    int best_slot = 1;
+    Selector best = RAW;
+    size_t best_size = LINE_SIZE;
+
+    auto attempt = [&](Selector selector, CompressionBase& codec) {
+        int slot = best_slot ^ 1;
+        size_t coded = codec.compress(line, LINE_SIZE, scratch[slot], SCRATCH_SIZE);
+        if (coded < best_size) {
+            best = selector;
+            best_size = coded;
+            best_slot = slot;
+        }
+    };
+
+    if (enabled_ & ENABLE_BDI) {
+        attempt(BDI_LINE, bdi_);
+    }
+    if (selection_ == Selection::EXHAUSTIVE) {
+        if (enabled_ & ENABLE_FPC) {
+            attempt(FPC_LINE, fpc_);
+        }
+        if (enabled_ & ENABLE_CPACK) {
+            attempt(CPACK_LINE, cpack_);
+        }
+    } else if ((enabled_ & (ENABLE_FPC | ENABLE_CPACK)) && best_size > MIN_PREDICTED_SIZE) {
+        // run only the predicted winner, and only if it beats BDI
+        size_t fpc_size;
+        size_t cpack_size;
+        predictSizes(cpack_, line, fpc_size, cpack_size);
+        if (!(enabled_ & ENABLE_FPC)) {
+            fpc_size = SIZE_MAX;
+        }
+        if (!(enabled_ & ENABLE_CPACK)) {
+            cpack_size = SIZE_MAX;
+        }
+        if (fpc_size <= cpack_size && fpc_size < best_size) {
+            attempt(FPC_LINE, fpc_);
+        } else if (cpack_size < fpc_size && cpack_size < best_size) {
+            attempt(CPACK_LINE, cpack_);
+        }
+    }
+
+    counts_[best]++;
+    if (best == RAW) {
+        std::memcpy(dst, line, LINE_SIZE);
+    } else {
+        std::memcpy(dst, scratch[best_slot], best_size);
+    }
+    size = best_size;
+    return best;
+}
+
+void Adaptive::decompressLine(Selector selector, const uint8_t* src, size_t size, uint8_t* dst) {
+    size_t written;
+    switch (selector) {
+        case RAW:
+            if (size != LINE_SIZE) {
+                throw std::runtime_error("Invalid compressed line");
+            }
+            std::memcpy(dst, src, LINE_SIZE);
+            return;
+        case BDI_LINE:
+            written = bdi_.decompress(src, size, dst, LINE_SIZE);
+            break;
+        case FPC_LINE:
+            written = fpc_.decompress(src, size, dst, LINE_SIZE);
+            break;
+        case CPACK_LINE:
+        default:
+            written = cpack_.decompress(src, size, dst, LINE_SIZE);
+            break;
+    }
+    if (written != LINE_SIZE) {
+        throw std::runtime_error("Invalid compressed line");
+    }
+}
+
+size_t Adaptive::compress(const uint8_t* src, size_t src_size,
+                          uint8_t* dst, size_t dst_capacity) {
+    if (src_size > UINT32_MAX) {
+        throw std::runtime_error("Input too large");
+    }
+    if (dst_capacity < maxCompressedSize(src_size)) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    storeSize(dst, static_cast<uint32_t>(src_size));
+
+    const size_t num_lines = src_size / LINE_SIZE;
+    uint8_t* descriptors = dst + HEADER_SIZE;
+    uint8_t* op = descriptors + num_lines;
+    for (size_t i = 0; i < num_lines; i++) {
+        size_t size;
+        Selector selector = compressLine(src + i * LINE_SIZE, op, size);
+        descriptors[i] = static_cast<uint8_t>(selector << 6 | (selector == RAW ? 0 : size));
+        op += size;
+    }
+
+    size_t tail = src_size - num_lines * LINE_SIZE;
+    if (tail > 0) {
+        std::memcpy(op, src + num_lines * LINE_SIZE, tail);
+        op += tail;
+    }
+    return op - dst;
+}
+
+size_t Adaptive::decompress(const uint8_t* src, size_t src_size,
+                            uint8_t* dst, size_t dst_capacity) {
+    size_t size = decompressedSize(src, src_size);
+    if (size > dst_capacity) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    const size_t num_lines = size / LINE_SIZE;
+    if (src_size - HEADER_SIZE < num_lines) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    const uint8_t* descriptors = src + HEADER_SIZE;
+    const uint8_t* ip = descriptors + num_lines;
+    const uint8_t* const iend = src + src_size;
+    for (size_t i = 0; i < num_lines; i++) {
+        Selector selector = static_cast<Selector>(descriptors[i] >> 6);
+        size_t line_size = selector == RAW ? LINE_SIZE : descriptors[i] & 0x3F;
+        if (static_cast<size_t>(iend - ip) < line_size) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        decompressLine(selector, ip, line_size, dst + i * LINE_SIZE);
+        ip += line_size;
+    }
+
+    size_t tail = size - num_lines * LINE_SIZE;
+    if (static_cast<size_t>(iend - ip) != tail) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    if (tail > 0) {
+        std::memcpy(dst + num_lines * LINE_SIZE, ip, tail);
+    }
+    return size;
+}
+
+size_t Adaptive::decompressedSize(const uint8_t* src, size_t src_size) const {
+    if (src_size < HEADER_SIZE) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return src[0] | (src[1] << 8) | (src[2] << 16) | (size_t(src[3]) << 24);
+}
+
+size_t Adaptive::compressLines(const uint8_t* src, size_t num_lines,
+                               uint8_t* dst, size_t dst_capacity,
+                               LineRecord* records) {
+    size_t written = 0;
+    for (size_t i = 0; i < num_lines; i++) {
+        if (dst_capacity - written < LINE_SIZE) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        size_t size;
+        records[i].tag = compressLine(src + i * LINE_SIZE, dst + written, size);
+        records[i].size = static_cast<uint8_t>(size);
+        written += size;
+    }
+    return written;
+}
+
+void Adaptive::decompressLines(const uint8_t* src, size_t src_size,
+                               const LineRecord* records, size_t num_lines,
+                               uint8_t* dst) {
+    size_t offset = 0;
+    for (size_t i = 0; i < num_lines; i++) {
+        if (src_size - offset < records[i].size || records[i].tag > CPACK_LINE) {
+            throw std::runtime_error("Invalid compressed line");
+        }
+        decompressLine(static_cast<Selector>(records[i].tag), src + offset, records[i].size,
+                       dst + i * LINE_SIZE);
+        offset += records[i].size;
+    }
+}
+
+} // namespace compression
@@ -0,0 +1,416 @@
+// src/ans.cc
+#include "compression/ans.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace compression {
+
+namespace {
+
+int highBit(uint32_t value) {
+    return 31 - __builtin_clz(value);
+}
+
+void storeSize(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint32_t loadSize(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+// per symbol encoding transform, see ANS::compress
+struct EncodeSymbol {
+    int32_t deltaFindState;
+    uint32_t deltaNbBits;
+};
+
+// LSB-first writer, stores 4 bytes once 32 bits are pending
+class ForwardBitWriter {
+private:
+    uint8_t* p_;
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+
+public:
+    explicit ForwardBitWriter(uint8_t* dst) : p_(dst) {}
+
+    // nbits <= 32
+    void put(uint32_t value, unsigned nbits) {
+        acc_ |= uint64_t(value) << bits_;
+        bits_ += nbits;
+        if (bits_ >= 32) {
+            uint32_t low = static_cast<uint32_t>(acc_);
+            std::memcpy(p_, &low, 4);
+            p_ += 4;
+            acc_ >>= 32;
+            bits_ -= 32;
+        }
+    }
+
+    // end mark and the last partial bytes, return the end
+    uint8_t* finish() {
+        put(1, 1);
+        while (bits_ > 0) {
+            *p_++ = static_cast<uint8_t>(acc_);
+            acc_ >>= 8;
+            bits_ = bits_ > 8 ? bits_ - 8 : 0;
+        }
+        return p_;
+    }
+};
+
+// nbits of a stream from bit pos up, the stream may end within 8 bytes
+uint32_t peekBits(const uint8_t* stream, size_t stream_size, size_t pos, unsigned nbits) {
+    uint64_t value = 0;
+    size_t byte = pos >> 3;
+    std::memcpy(&value, stream + byte, std::min<size_t>(8, stream_size - byte));
+    return static_cast<uint32_t>(value >> (pos & 7)) & ((uint32_t(1) << nbits) - 1);
+}
+
+} // namespace
+
+ANS::ANS(int table_log) : table_log_(table_log) {
+    if (table_log < MIN_TABLE_LOG || table_log > MAX_TABLE_LOG) {
+        throw std::invalid_argument("ANS table log out of range");
+    }
+}
+
+void ANS::normalizeCounts(const uint32_t* counts, int num_symbols,
+                          int table_log, uint16_t* normalized) {
+    const uint32_t target = uint32_t(1) << table_log;
+    uint64_t total = 0;
+    for (int s = 0; s < num_symbols; s++) {
+        total += counts[s];
+    }
+
+    int64_t sum = 0;
+    for (int s = 0; s < num_symbols; s++) {
+        if (counts[s] == 0) {
+            normalized[s] = 0;
+            continue;
+        }
+        uint64_t scaled = uint64_t(counts[s]) * target / total;
+        normalized[s] = static_cast<uint16_t>(std::max<uint64_t>(1, scaled));
+        sum += normalized[s];
+    }
+
+    // a symbol of count c and normalized count n costs c * log2(target / n)
+    // bits; grow or shrink whichever symbol gains most or loses least
+    while (sum != target) {
+        int best = -1;
+        double best_delta = 0;
+        for (int s = 0; s < num_symbols; s++) {
+            uint16_t n = normalized[s];
+            if (n == 0 || (sum > target && n == 1)) {
+                continue;
+            }
+            double delta = sum < target
+                ? counts[s] * std::log2((n + 1.0) / n)
+                : -double(counts[s]) * std::log2(n / (n - 1.0));
+            if (best < 0 || delta > best_delta) {
+                best = s;
+                best_delta = delta;
+            }
+        }
+        if (sum < target) {
+            normalized[best]++;
+            sum++;
+        } else {
+            normalized[best]--;
+            sum--;
+        }
+    }
+}
+
+void ANS::spreadSymbols(const uint16_t* normalized, int max_symbol,
+                        int table_log, uint8_t* spread) {
+    // an odd step visits every position of the power of two table once
+    const uint32_t size = uint32_t(1) << table_log;
+    const uint32_t mask = size - 1;
+    const uint32_t step = (size >> 1) + (size >> 3) + 3;
+    uint32_t position = 0;
+    for (int s = 0; s <= max_symbol; s++) {
+        for (uint32_t i = 0; i < normalized[s]; i++) {
+            spread[position] = static_cast<uint8_t>(s);
+            position = (position + step) & mask;
+        }
+    }
+}
+
+size_t ANS::compress(const uint8_t* src, size_t src_size,
+                     uint8_t* dst, size_t dst_capacity) {
+    if (src_size > UINT32_MAX) {
+        throw std::runtime_error("Input too large");
+    }
+    if (dst_capacity < HEADER_SIZE) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    storeSize(dst, static_cast<uint32_t>(src_size));
+
+    uint32_t counts[256] = {};
+    for (size_t i = 0; i < src_size; i++) {
+        counts[src[i]]++;
+    }
+    int max_symbol = -1;
+    int num_symbols = 0;
+    for (int s = 0; s < 256; s++) {
+        if (counts[s] > 0) {
+            max_symbol = s;
+            num_symbols++;
+        }
+    }
+
+    auto store = [&]() {
+        if (dst_capacity - HEADER_SIZE < src_size) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        dst[4] = RAW;
+        if (src_size > 0) {
+            std::memcpy(dst + HEADER_SIZE, src, src_size);
+        }
+        return HEADER_SIZE + src_size;
+    };
+    if (num_symbols == 0) {
+        return store();
+    }
+    if (num_symbols == 1) {
+        if (dst_capacity < HEADER_SIZE + 1) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        dst[4] = RLE;
+        dst[5] = static_cast<uint8_t>(max_symbol);
+        return HEADER_SIZE + 1;
+    }
+
+    // small inputs need no large table, but every symbol needs a state
+    // with some to spare
+    int table_log = std::min(table_log_, std::max(MIN_TABLE_LOG, highBit(static_cast<uint32_t>(src_size))));
+    table_log = std::max(table_log, highBit(num_symbols - 1) + 2);
+    const uint32_t size = uint32_t(1) << table_log;
+
+    uint16_t normalized[256];
+    normalizeCounts(counts, max_symbol + 1, table_log, normalized);
+
+    // Encoding state X lies in [size, 2 * size). Coding symbol s first
+    // emits the low bits of X until X >> bits falls into s's range
+    // [norm, 2 * norm), then moves to the state the table lists for it;
+    // deltaNbBits makes the bit count a single add and shift
+    uint8_t spread[1 << MAX_TABLE_LOG];
+    spreadSymbols(normalized, max_symbol, table_log, spread);
+    uint32_t cumul[257];
+    cumul[0] = 0;
+    for (int s = 0; s <= max_symbol; s++) {
+        cumul[s + 1] = cumul[s] + normalized[s];
+    }
+    stateTable_.resize(size);
+    uint32_t next[256];
+    std::copy(cumul, cumul + max_symbol + 1, next);
+    for (uint32_t u = 0; u < size; u++) {
+        stateTable_[next[spread[u]]++] = static_cast<uint16_t>(size + u);
+    }
+    EncodeSymbol symbols[256];
+    for (int s = 0; s <= max_symbol; s++) {
+        uint32_t n = normalized[s];
+        if (n == 0) {
+            continue;
+        }
+        uint32_t max_bits_out = table_log - (n == 1 ? 0 : highBit(n - 1));
+        symbols[s].deltaNbBits = (max_bits_out << 16) - (n << max_bits_out);
+        symbols[s].deltaFindState = static_cast<int32_t>(cumul[s]) - static_cast<int32_t>(n);
+    }
+
+    // every symbol emits at most table_log bits
+    stream_.resize((src_size * table_log + 2 * table_log + 1) / 8 + 8);
+    ForwardBitWriter writer(stream_.data());
+    // two states take turns, even positions on the first, so the decoder
+    // has two independent lookups in flight
+    const uint16_t* state_table = stateTable_.data();
+    uint32_t states[2] = {size, size};
+    for (size_t i = src_size; i-- > 0;) {
+        const EncodeSymbol& symbol = symbols[src[i]];
+        uint32_t& state = states[i & 1];
+        uint32_t nb_bits = (state + symbol.deltaNbBits) >> 16;
+        writer.put(state & ((uint32_t(1) << nb_bits) - 1), nb_bits);
+        state = state_table[(state >> nb_bits) + symbol.deltaFindState];
+    }
+    writer.put(states[1] - size, table_log);
+    writer.put(states[0] - size, table_log);
+    size_t stream_size = writer.finish() - stream_.data();
+
+    // header and counts
+    uint8_t header[2 + 256 * 2];
+    size_t header_size = 0;
+    header[header_size++] = static_cast<uint8_t>(table_log);
+    header[header_size++] = static_cast<uint8_t>(max_symbol);
+    for (int s = 0; s <= max_symbol; s++) {
+        uint32_t n = normalized[s];
+        while (n >= 0x80) {
+            header[header_size++] = static_cast<uint8_t>(n | 0x80);
+            n >>= 7;
+        }
+        header[header_size++] = static_cast<uint8_t>(n);
+    }
+
+    if (header_size + stream_size >= src_size) {
+        return store();
+    }
+    if (dst_capacity - HEADER_SIZE < header_size + stream_size) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    dst[4] = CODED;
+    std::memcpy(dst + HEADER_SIZE, header, header_size);
+    std::memcpy(dst + HEADER_SIZE + header_size, stream_.data(), stream_size);
+    return HEADER_SIZE + header_size + stream_size;
+}
+
+size_t ANS::decompress(const uint8_t* src, size_t src_size,
+                       uint8_t* dst, size_t dst_capacity) {
+    size_t size = decompressedSize(src, src_size);
+    if (size > dst_capacity) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    const uint8_t* ip = src + HEADER_SIZE;
+    const uint8_t* const iend = src + src_size;
+
+    if (src[4] == RAW) {
+        if (static_cast<size_t>(iend - ip) != size) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        if (size > 0) {
+            std::memcpy(dst, ip, size);
+        }
+        return size;
+    }
+    if (src[4] == RLE) {
+        if (iend - ip != 1) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        std::memset(dst, *ip, size);
+        return size;
+    }
+    if (src[4] != CODED || iend - ip < 2) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+
+    int table_log = *ip++;
+    int max_symbol = *ip++;
+    if (table_log < MIN_TABLE_LOG || table_log > MAX_TABLE_LOG) {
+        throw std::runtime_error("Invalid table log");
+    }
+    const uint32_t table_size = uint32_t(1) << table_log;
+    uint16_t normalized[256];
+    uint32_t sum = 0;
+    for (int s = 0; s <= max_symbol; s++) {
+        uint32_t n = 0;
+        for (int shift = 0;; shift += 7) {
+            if (ip == iend || shift > 14) {
+                throw std::runtime_error("Invalid compressed data");
+            }
+            uint8_t byte = *ip++;
+            n |= uint32_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        if (n > table_size) {
+            throw std::runtime_error("Invalid normalized counts");
+        }
+        normalized[s] = static_cast<uint16_t>(n);
+        sum += n;
+    }
+    if (sum != table_size) {
+        throw std::runtime_error("Invalid normalized counts");
+    }
+
+    // decoding state u in [0, size) is encoding state size + u: it yields
+    // its spread symbol, then reads bits to get back to the previous state
+    uint8_t spread[1 << MAX_TABLE_LOG];
+    spreadSymbols(normalized, max_symbol, table_log, spread);
+    decodeTable_.resize(table_size);
+    uint32_t next[256];
+    std::copy(normalized, normalized + max_symbol + 1, next);
+    for (uint32_t u = 0; u < table_size; u++) {
+        uint8_t s = spread[u];
+        uint32_t x = next[s]++;
+        uint8_t nb_bits = static_cast<uint8_t>(table_log - highBit(x));
+        decodeTable_[u] = {static_cast<uint16_t>((x << nb_bits) - table_size), s, nb_bits};
+    }
+    const DecodeEntry* table = decodeTable_.data();
+
+    // the stream is read from its end mark down to bit 0
+    size_t stream_size = iend - ip;
+    if (stream_size == 0 || ip[stream_size - 1] == 0) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    size_t pos = (stream_size - 1) * 8 + highBit(ip[stream_size - 1]);
+
+    if (pos < 2 * static_cast<size_t>(table_log)) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    pos -= table_log;
+    uint32_t state0 = peekBits(ip, stream_size, pos, table_log);
+    pos -= table_log;
+    uint32_t state1 = peekBits(ip, stream_size, pos, table_log);
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + size;
+
+    // Four symbols at a time take at most 4 * MAX_TABLE_LOG = 48 bits, so
+    // one 8-byte load ending at the byte of pos feeds them all; stepping
+    // one symbol is a table lookup and a shift, with no checks. The first
+    // 64 bits of the stream are read with checks.
+    while (op < oend) {
+        if (pos >= 64 && !((op - dst) & 1)) {
+            while (oend - op >= 4 && pos >= 64) {
+                const size_t base = (pos >> 3) - 7;
+                uint64_t bits;
+                std::memcpy(&bits, ip + base, 8);
+                unsigned avail = static_cast<unsigned>(pos - base * 8);
+                auto step = [&](uint32_t& state, uint8_t* out) {
+                    DecodeEntry entry = table[state];
+                    *out = entry.symbol;
+                    avail -= entry.nbBits;
+                    state = entry.newState +
+                            (static_cast<uint32_t>(bits >> avail) & ((uint32_t(1) << entry.nbBits) - 1));
+                };
+                step(state0, op);
+                step(state1, op + 1);
+                step(state0, op + 2);
+                step(state1, op + 3);
+                op += 4;
+                pos = base * 8 + avail;
+            }
+            if (op == oend) {
+                break;
+            }
+        }
+        const bool odd = (op - dst) & 1;
+        DecodeEntry entry = table[odd ? state1 : state0];
+        *op++ = entry.symbol;
+        if (pos < entry.nbBits) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        pos -= entry.nbBits;
+        uint32_t state = entry.newState + peekBits(ip, stream_size, pos, entry.nbBits);
+        (odd ? state1 : state0) = state;
+    }
+
+    // the encoder started both states at size, its first bits are at bit 0
+    if (pos != 0 || state0 != 0 || state1 != 0) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return size;
+}
+
+size_t ANS::decompressedSize(const uint8_t* src, size_t src_size) const {
+    if (src_size < HEADER_SIZE) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return loadSize(src);
+}
+
+} // namespace compression
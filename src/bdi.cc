@@ -1,195 +1,340 @@
 #include "compression/bdi.h"
+#include "bdi_kernel.h"
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace compression {
 
-BDI::BDI() = default;
-
-std::vector<uint8_t> BDI::compress(const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> compressed;
-    
-    for (size_t i = 0; i < data.size(); i += 64) {  // Process 64-byte blocks
-        auto block = compressBlock(data, i);
-        
-        // Store encoding
-        compressed.push_back(block.encoding);
-        
-        uint8_t base_size = getBaseSize(block.encoding);
-
-        if (block.encoding != UNCOMPRESSED) {
-            // shift base value in to compressed data
-            for (size_t j = 0; j < base_size; ++j) {
-                compressed.push_back((block.base >> (j * 8)) & 0xFF);
-            }
-            // Store deltas
-            compressed.insert(compressed.end(), block.deltas.begin(), block.deltas.end());
+BDI::BDI() {
+    // base+delta encodings in table order, single-base before dual-base,
+    // and ranked by compressed size
+    for (uint8_t i = 0; i < NUM_DELTA_ENCODINGS; i++) {
+        first_fit_order_[i] = BASE8_DELTA1 + i;
+        first_fit_order_[NUM_DELTA_ENCODINGS + i] = (BASE8_DELTA1 + i) | DUAL_BASE;
+    }
+    std::copy(first_fit_order_, first_fit_order_ + 2 * NUM_DELTA_ENCODINGS, smallest_order_);
+    std::stable_sort(smallest_order_, smallest_order_ + 2 * NUM_DELTA_ENCODINGS,
+                     [this](uint8_t a, uint8_t b) { return compSize(a) < compSize(b); });
+}
+
+size_t BDI::maxCompressedSize(size_t src_size) const {
+    // every line, including a trailing partial one, costs at most one
+    // encoding byte on top of its raw bytes
+    return src_size + (src_size + LINE_SIZE - 1) / LINE_SIZE;
+}
+
+size_t BDI::compress(const uint8_t* src, size_t src_size,
+                     uint8_t* dst, size_t dst_capacity) {
+    return compressRange(src, src_size, dst, dst_capacity, nullptr);
+}
+
+size_t BDI::compressLines(const uint8_t* src, size_t num_lines,
+                          uint8_t* dst, size_t dst_capacity,
+                          LineRecord* records) {
+    // lines are compressed independently, so the batch is one range
+    return compressRange(src, num_lines * LINE_SIZE, dst, dst_capacity, records);
+}
+
+size_t BDI::compressRange(const uint8_t* src, size_t src_size,
+                          uint8_t* dst, size_t dst_capacity, LineRecord* records) {
+    size_t written = 0;
+
+    for (size_t i = 0; i < src_size; i += LINE_SIZE) {  // Process 64-byte blocks
+        size_t block_size = std::min(LINE_SIZE, src_size - i);
+        size_t block_len;
+
+        if (dst_capacity - written >= MAX_BLOCK_SIZE) {
+            block_len = compressBlock(src + i, block_size, dst + written);
         } else {
-            // Store uncompressed data
-            compressed.insert(compressed.end(), 
-                            data.begin() + i,
-                            data.begin() + std::min(i + 64, data.size()));
+            // not enough room for a worst-case block, encode aside first
+            uint8_t block[MAX_BLOCK_SIZE];
+            block_len = compressBlock(src + i, block_size, block);
+            if (dst_capacity - written < block_len) {
+                throw std::runtime_error("Output buffer too small");
+            }
+            std::memcpy(dst + written, block, block_len);
+        }
+
+        if (records) {
+            records[i / LINE_SIZE].size = static_cast<uint8_t>(block_len);
+            records[i / LINE_SIZE].tag = dst[written];
         }
+        written += block_len;
     }
-    
-    return compressed;
+
+    return written;
 }
 
-std::vector<uint8_t> BDI::decompress(const std::vector<uint8_t>& compressed_data) {
-    std::vector<uint8_t> decompressed;
+size_t BDI::decompress(const uint8_t* src, size_t src_size,
+                       uint8_t* dst, size_t dst_capacity) {
+    size_t written = 0;
     size_t offset = 0;
-    
-    while (offset < compressed_data.size()) {
-        auto block = decompressBlock(compressed_data, offset);
-        decompressed.insert(decompressed.end(), block.begin(), block.end());
+
+    while (offset < src_size) {
+        written += decompressBlock(src, src_size, offset,
+                                   dst + written, dst_capacity - written);
     }
-    
-    return decompressed;
+
+    return written;
 }
 
-BDI::CompressedBlock
-BDI::compressBlkEncode(const std::vector<uint8_t>& data, size_t offset, uint8_t encoding) {
-    uint8_t base_size = getBaseSize(encoding);
-    uint8_t delta_size = getDeltaSize(encoding);
-    int64_t delta_limit_max = getDeltaLimitMax(encoding);
-    int64_t delta_limit_min = getDeltaLimitMin(encoding);
+size_t BDI::decompressedSize(const uint8_t* src, size_t src_size) const {
+    size_t size = 0;
+    size_t offset = 0;
 
-    CompressedBlock block;
+    while (offset < src_size) {
+        uint8_t encoding = src[offset++];
+        if (encoding == UNCOMPRESSED) {
+            size_t block_size = std::min(LINE_SIZE, src_size - offset);
+            size += block_size;
+            offset += block_size;
+        } else if (isValidEncoding(encoding)) {
+            size += LINE_SIZE;
+            offset += compSize(encoding);
+        } else {
+            throw std::runtime_error("Invalid encoding byte");
+        }
+    }
+
+    if (offset > src_size) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return size;
+}
 
-    uint64_t base = findBase(data, offset, base_size);
+namespace {
 
-    size_t block_size = std::min(size_t(64), data.size() - offset);
+// true if every delta of the line's base_size view lies in [limit_min, limit_max]
+bool deltaFits(const bdi_kernel::DeltaRange& range, uint8_t base_size,
+               int64_t limit_min, int64_t limit_max) {
+    int64_t min, max;
+    if (base_size == 8) {
+        min = range.min8;
+        max = range.max8;
+    } else if (base_size == 4) {
+        min = range.min4;
+        max = range.max4;
+    } else {
+        min = range.min2;
+        max = range.max2;
+    }
+    return min >= limit_min && max <= limit_max;
+}
 
-    bool compressible = true;
+// element of size bytes, zero extended
+uint64_t loadElement(const uint8_t* p, uint8_t size) {
+    if (size == 8) {
+        return loadValue<uint64_t>(p);
+    } else if (size == 4) {
+        return loadValue<uint32_t>(p);
+    }
+    return loadValue<uint16_t>(p);
+}
 
-    std::vector<uint8_t> deltas;
-    for (size_t i = 0; i < block_size; i += base_size) {
-        int64_t value;
+// value wrapped to size bytes and sign extended
+int64_t signExtend(uint64_t value, uint8_t size) {
+    if (size == 8) {
+        return static_cast<int64_t>(value);
+    } else if (size == 4) {
+        return static_cast<int32_t>(value);
+    }
+    return static_cast<int16_t>(value);
+}
+
+} // namespace
+
+void BDI::compressBlkEncode(const uint8_t* line, uint8_t encoding, uint8_t* dst) {
+    uint8_t base_size = getBaseSize(encoding);
+    uint8_t delta_size = getDeltaSize(encoding);
+
+    uint64_t base = findBase(line, base_size);
+
+    // encoding byte, then the base value in little endian
+    *dst++ = encoding;
+    std::memcpy(dst, &base, base_size);
+    dst += base_size;
+
+    // deltas wrap at the element width, the decoder truncates base + delta
+    for (size_t i = 0; i < LINE_SIZE; i += base_size) {
+        uint64_t delta;
         if (base_size == 8) {
-            value = getValue<uint64_t>(data, offset, i);
+            delta = loadValue<uint64_t>(line + i) - base;
         } else if (base_size == 4) {
-            value = getValue<uint32_t>(data, offset, i);
-        } else if (base_size == 2) {
-            value = getValue<uint16_t>(data, offset, i);
+            delta = static_cast<uint64_t>(static_cast<int32_t>(loadValue<uint32_t>(line + i) - uint32_t(base)));
+        } else {
+            delta = static_cast<uint64_t>(static_cast<int16_t>(loadValue<uint16_t>(line + i) - uint16_t(base)));
         }
+        std::memcpy(dst, &delta, delta_size);
+        dst += delta_size;
+    }
+}
 
-        int64_t delta = value - base;
+bool BDI::compressDualEncode(const uint8_t* line, uint8_t encoding, uint8_t* dst) {
+    uint8_t base_size = getBaseSize(encoding);
+    uint8_t delta_size = getDeltaSize(encoding);
+    int64_t delta_limit_max = getDeltaLimitMax(encoding);
+    int64_t delta_limit_min = getDeltaLimitMin(encoding);
+    size_t elements = LINE_SIZE / base_size;
+    size_t mask_size = elements / 8;
+
+    // encoding byte, mask, base, deltas
+    uint8_t* deltas = dst + 1 + mask_size + base_size;
+    uint64_t mask = 0;
+    uint64_t base = 0;
+    bool has_base = false;
+
+    for (size_t i = 0; i < elements; i++) {
+        uint64_t value = loadElement(line + i * base_size, base_size);
+        int64_t delta = signExtend(value, base_size);
+
+        // the explicit base is the first element too far from zero
         if (delta < delta_limit_min || delta > delta_limit_max) {
-            compressible = false;
-            //printf("base %0#lx value %0#lx base_size: %d, delta_size: %d, delta: %0#lx false delta_limit_min: %0#lx delta_limit_max: %0#lx delta < delta_limit_min: %d delta > delta_limit_max: %d\n",
-            //base, value, base_size, delta_size, delta, delta_limit_min, delta_limit_max, delta < delta_limit_min, delta > delta_limit_max);
-            break;
+            if (!has_base) {
+                base = value;
+                has_base = true;
+            }
+            delta = signExtend(value - base, base_size);
+            if (delta < delta_limit_min || delta > delta_limit_max) {
+                return false;
+            }
+            mask |= uint64_t(1) << i;
         }
 
-        for (int i = 0; i < delta_size; i++) {
-            deltas.push_back((delta >> (i * 8)) & 0xFF);
-        }
+        std::memcpy(deltas + i * delta_size, &delta, delta_size);
     }
 
-    if (compressible) {
-        block.encoding = encoding;
-        block.base = base;
-        block.deltas = deltas;
-    } else {
-        block.encoding = UNCOMPRESSED;
-    }
-
-    return block;
+    dst[0] = encoding;
+    std::memcpy(dst + 1, &mask, mask_size);
+    std::memcpy(dst + 1 + mask_size, &base, base_size);
+    return true;
 }
 
+size_t BDI::compressBlock(const uint8_t* line, size_t size, uint8_t* dst) {
+    // a trailing partial line is always stored as is
+    if (size == LINE_SIZE) {
+        // one pass over the line gives the delta range of every base size
+        bdi_kernel::DeltaRange range = bdi_kernel::scan(line);
 
-BDI::CompressedBlock BDI::compressBlock(const std::vector<uint8_t>& data, size_t offset) {
-    CompressedBlock block;
+        // every 8-byte element equals the first one
+        if (range.min8 == 0 && range.max8 == 0) {
+            uint64_t value = loadValue<uint64_t>(line);
+            if (value == 0) {
+                dst[0] = ZEROS;
+                return 1;
+            }
+            dst[0] = REPEAT;
+            storeValue<uint64_t>(dst + 1, value);
+            return 1 + compSize(REPEAT);
+        }
 
-    bool compressible = false;
-    for (uint8_t i = BASE8_DELTA1; i <= BASE8_DELTA4; i++) {
-        CompressedBlock tmp_block = compressBlkEncode(data, offset, i);
-        //printf("encoding: %d\n", tmp_block.encoding);
-        if (tmp_block.encoding != UNCOMPRESSED) {
-            block = tmp_block;
-            compressible = true;
-            break;
+        const uint8_t* order = selection_ == Selection::SMALLEST ? smallest_order_ : first_fit_order_;
+        for (uint8_t i = 0; i < 2 * NUM_DELTA_ENCODINGS; i++) {
+            uint8_t encoding = order[i];
+            if (encoding & DUAL_BASE) {
+                if (dual_base_ && compressDualEncode(line, encoding, dst)) {
+                    return 1 + compSize(encoding);
+                }
+            } else if (deltaFits(range, getBaseSize(encoding),
+                                 getDeltaLimitMin(encoding), getDeltaLimitMax(encoding))) {
+                compressBlkEncode(line, encoding, dst);
+                return 1 + compSize(encoding);
+            }
         }
     }
 
-    if (!compressible) {
-        block.encoding = UNCOMPRESSED;
-        block.deltas = std::vector<uint8_t>(data.begin() + offset, data.begin() + offset + 64);
-    }
-    
-    return block;
+    dst[0] = UNCOMPRESSED;
+    std::memcpy(dst + 1, line, size);
+    return 1 + size;
 }
 
-std::vector<uint8_t> BDI::decompressBlock(const std::vector<uint8_t>& data, size_t& offset) {
-    if (offset >= data.size()) {
+size_t BDI::decompressBlock(const uint8_t* src, size_t src_size, size_t& offset,
+                            uint8_t* dst, size_t dst_capacity) {
+    if (offset >= src_size) {
         throw std::runtime_error("Invalid compressed data");
     }
-    
-    uint8_t encoding = data[offset++];
-    std::vector<uint8_t> block;
-    
+
+    uint8_t encoding = src[offset++];
+
     if (encoding == UNCOMPRESSED) {
-        for (int i = 0; i < 64 && offset < data.size(); ++i) {
-            block.push_back(data[offset++]);
+        size_t block_size = std::min(LINE_SIZE, src_size - offset);
+        if (block_size > dst_capacity) {
+            throw std::runtime_error("Output buffer too small");
         }
-    } else {
-        uint8_t base_size = getBaseSize(encoding);
-        uint8_t delta_size = getDeltaSize(encoding);
+        std::memcpy(dst, src + offset, block_size);
+        offset += block_size;
+        return block_size;
+    }
 
-        //printf("base_size: %d, delta_size: %d\n", base_size, delta_size);
+    uint8_t base_size = getBaseSize(encoding);
+    uint8_t delta_size = getDeltaSize(encoding);
+    if (!isValidEncoding(encoding)) {
+        throw std::runtime_error("Invalid encoding byte");
+    }
+    if (src_size - offset < compSize(encoding)) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    if (dst_capacity < LINE_SIZE) {
+        throw std::runtime_error("Output buffer too small");
+    }
 
-        // Read base value
-        uint64_t base = 0;
-        for (size_t i = 0; i < base_size; ++i) {
-            base |= static_cast<uint64_t>(data[offset++]) << (i * 8);
-        }
-        
-        // Mask the base value according to its size
-        if (base_size == 2) {
-            base &= 0xFFFF;  // 16-bit mask
-        } else if (base_size == 4) {
-            base &= 0xFFFFFFFF;  // 32-bit mask
+    if (encoding == ZEROS) {
+        std::memset(dst, 0, LINE_SIZE);
+        return LINE_SIZE;
+    }
+    if (encoding == REPEAT) {
+        for (size_t i = 0; i < LINE_SIZE; i += 8) {
+            std::memcpy(dst + i, src + offset, 8);
         }
+        offset += 8;
+        return LINE_SIZE;
+    }
 
-        for (size_t i = 0; i < 64; i += base_size) {
-            uint64_t value = base;
-            if (delta_size == 1) {
-                value += static_cast<int8_t>(data[offset++]);
-            } else if (delta_size == 2) {
-                value += static_cast<int16_t>(data[offset] | (data[offset + 1] << 8));
-                offset += 2;
-            } else if (delta_size == 4) {
-                value += static_cast<int32_t>(data[offset] | 
-                                            (data[offset + 1] << 8) | 
-                                            (data[offset + 2] << 16) | 
-                                            (data[offset + 3] << 24));
-                offset += 4;
-            }
+    //printf("base_size: %d, delta_size: %d\n", base_size, delta_size);
 
-            // Mask the result according to base_size before storing
-            if (base_size == 2) {
-                value &= 0xFFFF;  // Keep only lower 16 bits
-            } else if (base_size == 4) {
-                value &= 0xFFFFFFFF;  // Keep only lower 32 bits
-            }
+    // Read the element mask of dual-base encodings, all ones otherwise
+    uint64_t mask = ~uint64_t(0);
+    if (encoding & DUAL_BASE) {
+        size_t mask_size = LINE_SIZE / base_size / 8;
+        mask = 0;
+        std::memcpy(&mask, src + offset, mask_size);
+        offset += mask_size;
+    }
 
-            // Store reconstructed value
-            for (size_t j = 0; j < base_size; ++j) {
-                block.push_back((value >> (j * 8)) & 0xFF);
-            }
+    // Read base value
+    uint64_t base = 0;
+    for (size_t i = 0; i < base_size; ++i) {
+        base |= static_cast<uint64_t>(src[offset++]) << (i * 8);
+    }
+
+    for (size_t i = 0; i < LINE_SIZE; i += base_size) {
+        uint64_t value = (mask >> (i / base_size)) & 1 ? base : 0;
+        if (delta_size == 1) {
+            value += static_cast<int8_t>(src[offset]);
+        } else if (delta_size == 2) {
+            value += static_cast<int16_t>(loadValue<uint16_t>(src + offset));
+        } else {
+            value += static_cast<int32_t>(loadValue<uint32_t>(src + offset));
+        }
+        offset += delta_size;
+
+        // Store reconstructed value, truncated to base_size
+        if (base_size == 8) {
+            storeValue<uint64_t>(dst + i, value);
+        } else if (base_size == 4) {
+            storeValue<uint32_t>(dst + i, static_cast<uint32_t>(value));
+        } else {
+            storeValue<uint16_t>(dst + i, static_cast<uint16_t>(value));
         }
     }
-    
-    return block;
+
+    return LINE_SIZE;
 }
 
-uint64_t BDI::findBase(const std::vector<uint8_t>& data, size_t offset, uint8_t base_size) {
+uint64_t BDI::findBase(const uint8_t* line, uint8_t base_size) {
     uint64_t base = 0;
-    size_t bytes_to_copy = std::min(size_t(base_size), data.size() - offset);
-    std::copy(data.begin() + offset,
-             data.begin() + offset + bytes_to_copy,
-             reinterpret_cast<uint8_t*>(&base));
+    std::memcpy(&base, line, base_size);
     return base;
 }
 
-} // namespace compression 
\ No newline at end of file
+} // namespace compression
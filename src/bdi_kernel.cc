@@ -0,0 +1,203 @@
+// src/bdi_kernel.cc
+#include "bdi_kernel.h"
+#include "compression/common.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BDI_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace compression {
+namespace bdi_kernel {
+
+DeltaRange scanScalar(const uint8_t* line) {
+    DeltaRange range = {0, 0, 0, 0, 0, 0};
+
+    uint64_t base8 = loadValue<uint64_t>(line);
+    for (int i = 8; i < 64; i += 8) {
+        int64_t delta = static_cast<int64_t>(loadValue<uint64_t>(line + i) - base8);
+        range.min8 = std::min(range.min8, delta);
+        range.max8 = std::max(range.max8, delta);
+    }
+
+    uint32_t base4 = loadValue<uint32_t>(line);
+    for (int i = 4; i < 64; i += 4) {
+        int32_t delta = static_cast<int32_t>(loadValue<uint32_t>(line + i) - base4);
+        range.min4 = std::min(range.min4, delta);
+        range.max4 = std::max(range.max4, delta);
+    }
+
+    uint16_t base2 = loadValue<uint16_t>(line);
+    for (int i = 2; i < 64; i += 2) {
+        int16_t delta = static_cast<int16_t>(loadValue<uint16_t>(line + i) - base2);
+        range.min2 = std::min(range.min2, delta);
+        range.max2 = std::max(range.max2, delta);
+    }
+
+    return range;
+}
+
+#if defined(BDI_KERNEL_X86)
+
+namespace {
+
+// horizontal reductions of one 128-bit register
+
+__attribute__((target("sse4.2")))
+inline int64_t hmin64(__m128i v) {
+    __m128i s = _mm_unpackhi_epi64(v, v);
+    return _mm_cvtsi128_si64(_mm_blendv_epi8(v, s, _mm_cmpgt_epi64(v, s)));
+}
+
+__attribute__((target("sse4.2")))
+inline int64_t hmax64(__m128i v) {
+    __m128i s = _mm_unpackhi_epi64(v, v);
+    return _mm_cvtsi128_si64(_mm_blendv_epi8(v, s, _mm_cmpgt_epi64(s, v)));
+}
+
+__attribute__((target("sse4.2")))
+inline int32_t hmin32(__m128i v) {
+    v = _mm_min_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_min_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse4.2")))
+inline int32_t hmax32(__m128i v) {
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_max_epi32(v, _mm_shuffle_epi32(v, 0xB1));
+    return _mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse4.2")))
+inline int16_t hmin16(__m128i v) {
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_min_epi16(v, _mm_shuffle_epi32(v, 0xB1));
+    v = _mm_min_epi16(v, _mm_srli_epi32(v, 16));
+    return static_cast<int16_t>(_mm_cvtsi128_si32(v));
+}
+
+__attribute__((target("sse4.2")))
+inline int16_t hmax16(__m128i v) {
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, 0x4E));
+    v = _mm_max_epi16(v, _mm_shuffle_epi32(v, 0xB1));
+    v = _mm_max_epi16(v, _mm_srli_epi32(v, 16));
+    return static_cast<int16_t>(_mm_cvtsi128_si32(v));
+}
+
+} // namespace
+
+__attribute__((target("sse4.2")))
+DeltaRange scanSSE42(const uint8_t* line) {
+    const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line));
+    const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 16));
+    const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 32));
+    const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + 48));
+    DeltaRange range;
+
+    // 8-byte view, there is no packed 64-bit min/max before AVX-512
+    __m128i base = _mm_unpacklo_epi64(v0, v0);
+    __m128i d0 = _mm_sub_epi64(v0, base);
+    __m128i d1 = _mm_sub_epi64(v1, base);
+    __m128i d2 = _mm_sub_epi64(v2, base);
+    __m128i d3 = _mm_sub_epi64(v3, base);
+    __m128i lo = _mm_blendv_epi8(d0, d1, _mm_cmpgt_epi64(d0, d1));
+    __m128i hi = _mm_blendv_epi8(d0, d1, _mm_cmpgt_epi64(d1, d0));
+    lo = _mm_blendv_epi8(lo, d2, _mm_cmpgt_epi64(lo, d2));
+    hi = _mm_blendv_epi8(hi, d2, _mm_cmpgt_epi64(d2, hi));
+    lo = _mm_blendv_epi8(lo, d3, _mm_cmpgt_epi64(lo, d3));
+    hi = _mm_blendv_epi8(hi, d3, _mm_cmpgt_epi64(d3, hi));
+    range.min8 = hmin64(lo);
+    range.max8 = hmax64(hi);
+
+    // 4-byte view
+    base = _mm_shuffle_epi32(v0, 0x00);
+    d0 = _mm_sub_epi32(v0, base);
+    d1 = _mm_sub_epi32(v1, base);
+    d2 = _mm_sub_epi32(v2, base);
+    d3 = _mm_sub_epi32(v3, base);
+    range.min4 = hmin32(_mm_min_epi32(_mm_min_epi32(d0, d1), _mm_min_epi32(d2, d3)));
+    range.max4 = hmax32(_mm_max_epi32(_mm_max_epi32(d0, d1), _mm_max_epi32(d2, d3)));
+
+    // 2-byte view
+    base = _mm_set1_epi16(static_cast<int16_t>(_mm_cvtsi128_si32(v0)));
+    d0 = _mm_sub_epi16(v0, base);
+    d1 = _mm_sub_epi16(v1, base);
+    d2 = _mm_sub_epi16(v2, base);
+    d3 = _mm_sub_epi16(v3, base);
+    range.min2 = hmin16(_mm_min_epi16(_mm_min_epi16(d0, d1), _mm_min_epi16(d2, d3)));
+    range.max2 = hmax16(_mm_max_epi16(_mm_max_epi16(d0, d1), _mm_max_epi16(d2, d3)));
+
+    return range;
+}
+
+__attribute__((target("avx2")))
+DeltaRange scanAVX2(const uint8_t* line) {
+    const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+    const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 32));
+    DeltaRange range;
+
+    // 8-byte view
+    __m256i base = _mm256_permute4x64_epi64(v0, 0x00);
+    __m256i d0 = _mm256_sub_epi64(v0, base);
+    __m256i d1 = _mm256_sub_epi64(v1, base);
+    __m256i lo = _mm256_blendv_epi8(d0, d1, _mm256_cmpgt_epi64(d0, d1));
+    __m256i hi = _mm256_blendv_epi8(d0, d1, _mm256_cmpgt_epi64(d1, d0));
+    __m128i lo128 = _mm256_castsi256_si128(lo);
+    __m128i lo_hi = _mm256_extracti128_si256(lo, 1);
+    __m128i hi128 = _mm256_castsi256_si128(hi);
+    __m128i hi_hi = _mm256_extracti128_si256(hi, 1);
+    range.min8 = hmin64(_mm_blendv_epi8(lo128, lo_hi, _mm_cmpgt_epi64(lo128, lo_hi)));
+    range.max8 = hmax64(_mm_blendv_epi8(hi128, hi_hi, _mm_cmpgt_epi64(hi_hi, hi128)));
+
+    // 4-byte view
+    base = _mm256_broadcastd_epi32(_mm256_castsi256_si128(v0));
+    d0 = _mm256_sub_epi32(v0, base);
+    d1 = _mm256_sub_epi32(v1, base);
+    lo = _mm256_min_epi32(d0, d1);
+    hi = _mm256_max_epi32(d0, d1);
+    range.min4 = hmin32(_mm_min_epi32(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+    range.max4 = hmax32(_mm_max_epi32(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+
+    // 2-byte view
+    base = _mm256_broadcastw_epi16(_mm256_castsi256_si128(v0));
+    d0 = _mm256_sub_epi16(v0, base);
+    d1 = _mm256_sub_epi16(v1, base);
+    lo = _mm256_min_epi16(d0, d1);
+    hi = _mm256_max_epi16(d0, d1);
+    range.min2 = hmin16(_mm_min_epi16(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1)));
+    range.max2 = hmax16(_mm_max_epi16(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1)));
+
+    return range;
+}
+
+ScanFn scanner() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return scanAVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return scanSSE42;
+    }
+    return scanScalar;
+}
+
+#else
+
+DeltaRange scanSSE42(const uint8_t* line) {
+    return scanScalar(line);
+}
+
+DeltaRange scanAVX2(const uint8_t* line) {
+    return scanScalar(line);
+}
+
+ScanFn scanner() {
+    return scanScalar;
+}
+
+#endif
+
+} // namespace bdi_kernel
+} // namespace compression
@@ -0,0 +1,37 @@
+// src/bdi_kernel.h
+// Internal BDI encoding-selection kernels, not part of the public headers.
+#ifndef BDI_KERNEL_H
+#define BDI_KERNEL_H
+
+#include <cstdint>
+
+namespace compression {
+namespace bdi_kernel {
+
+// Signed range of the deltas of a 64-byte line against its first element,
+// for the 8-, 4- and 2-byte views of the line. Deltas wrap at the element
+// width, the decoder truncates base + delta to the same width.
+struct DeltaRange {
+    int64_t min8, max8;
+    int32_t min4, max4;
+    int16_t min2, max2;
+};
+
+using ScanFn = DeltaRange (*)(const uint8_t* line);
+
+DeltaRange scanScalar(const uint8_t* line);
+DeltaRange scanSSE42(const uint8_t* line);
+DeltaRange scanAVX2(const uint8_t* line);
+
+// Best kernel for the running CPU, resolved once
+ScanFn scanner();
+
+inline DeltaRange scan(const uint8_t* line) {
+    static const ScanFn fn = scanner();
+    return fn(line);
+}
+
+} // namespace bdi_kernel
+} // namespace compression
+
+#endif // BDI_KERNEL_H
@@ -1,167 +1,354 @@
 #include "compression/cpack.h"
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace compression {
 
-CPack::CPack() : dict_(1024) {
+CPack::CPack(size_t dict_entries)
+    : flat_dict_(std::max(size_t(1), std::min(dict_entries, FLAT_DICT_ENTRIES))),
+      dict_(dict_entries),
+      use_flat_dict_(dict_entries <= FLAT_DICT_ENTRIES),
+      index_bits_(1) {
+    if (dict_entries == 0) {
+        throw std::invalid_argument("CPack dictionary needs at least one entry");
+    }
+    while ((size_t(1) << index_bits_) < dict_entries) {
+        index_bits_++;
+    }
 }
 
-std::vector<uint8_t> CPack::compress(const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> compressed;
-    
-    // Process data in blocks of 64 bytes
-    for (size_t i = 0; i < data.size(); i += 64 ) {
-        for (size_t j = 0; j < 64; j += 4) {
-            size_t remaining = std::min(size_t(4), data.size() - i-j);
-            auto block = compress2Word(data, i+j, remaining);
-            
-            // Add pattern byte
-            compressed.push_back(block.pattern);
+size_t CPack::maxCompressedSize(size_t src_size) const {
+    // every word may miss (34 bits), a trailing partial word costs 6 bits
+    // plus its bytes
+    size_t tail = src_size % WORD_SIZE;
+    size_t bits = src_size / WORD_SIZE * 34 + (tail ? 6 + tail * 8 : 0);
+    return (bits + 7) / 8;
+}
 
-            for (int i = 0; i < 4; i++) {
-                compressed.push_back((block.dict_index >> (i * 8)) & 0xFF);
-            }
-            
-            // Add compressed data
-            compressed.insert(compressed.end(), block.unmatch_data.begin(), block.unmatch_data.end());           
+size_t CPack::compress(const uint8_t* src, size_t src_size,
+                       uint8_t* dst, size_t dst_capacity) {
+    if (use_flat_dict_) {
+        return compressWords(flat_dict_, src, src_size, dst, dst_capacity);
+    }
+    return compressWords(dict_, src, src_size, dst, dst_capacity);
+}
+
+size_t CPack::decompress(const uint8_t* src, size_t src_size,
+                         uint8_t* dst, size_t dst_capacity) {
+    if (use_flat_dict_) {
+        return decompressWords(flat_dict_, src, src_size, dst, dst_capacity);
+    }
+    return decompressWords(dict_, src, src_size, dst, dst_capacity);
+}
+
+template <typename Dict>
+size_t CPack::compressWords(Dict& dict, const uint8_t* src, size_t src_size,
+                            uint8_t* dst, size_t dst_capacity) {
+    dict.clear();
+    BitWriter out(dst, dst_capacity);
+
+    size_t full_size = src_size - src_size % WORD_SIZE;
+    encodeWords(dict, src, full_size, out);
+    encodeTail(src + full_size, src_size - full_size, out);
+
+    return out.finish();
+}
+
+template <typename Dict>
+void CPack::encodeWords(Dict& dict, const uint8_t* src, size_t src_size, BitWriter& out) {
+    for (size_t i = 0; i + WORD_SIZE <= src_size; i += WORD_SIZE) {
+        auto block = compress2Word(dict, loadValue<uint32_t>(src + i));
+
+        //printf("compressed 2 word %s\n", printCompressed2Word(block).c_str());
+
+        encode2Word(block, out);
+    }
+}
+
+void CPack::encodeTail(const uint8_t* src, size_t size, BitWriter& out) const {
+    if (size == 0) {
+        return;
+    }
+    out.put(0b1111, 4);
+    out.put(size, 2);
+    for (size_t i = 0; i < size; i++) {
+        out.put(src[i], 8);
+    }
+}
+
+void CPack::begin() {
+    if (use_flat_dict_) {
+        flat_dict_.clear();
+    } else {
+        dict_.clear();
+    }
+    stream_bits_ = BitWriter::State();
+    stream_tail_size_ = 0;
+}
+
+size_t CPack::update(const uint8_t* src, size_t src_size,
+                     uint8_t* dst, size_t dst_capacity) {
+    BitWriter out(dst, dst_capacity, stream_bits_);
+    if (use_flat_dict_) {
+        updateWords(flat_dict_, src, src_size, out);
+    } else {
+        updateWords(dict_, src, src_size, out);
+    }
+    stream_bits_ = out.state();
+    return out.written();
+}
+
+template <typename Dict>
+void CPack::updateWords(Dict& dict, const uint8_t* src, size_t src_size, BitWriter& out) {
+    // complete the word left over from the previous update
+    if (stream_tail_size_ > 0) {
+        size_t take = std::min(WORD_SIZE - stream_tail_size_, src_size);
+        std::memcpy(stream_tail_ + stream_tail_size_, src, take);
+        stream_tail_size_ += take;
+        src += take;
+        src_size -= take;
+        if (stream_tail_size_ < WORD_SIZE) {
+            return;
         }
+        encodeWords(dict, stream_tail_, WORD_SIZE, out);
+        stream_tail_size_ = 0;
     }
-    
-    return compressed;
+
+    size_t full_size = src_size - src_size % WORD_SIZE;
+    encodeWords(dict, src, full_size, out);
+    stream_tail_size_ = src_size - full_size;
+    std::memcpy(stream_tail_, src + full_size, stream_tail_size_);
 }
 
-std::vector<uint8_t> CPack::decompress(const std::vector<uint8_t>& compressed_data) {
-    std::vector<uint8_t> decompressed;
-    size_t offset = 0;
-    
-    while (offset < compressed_data.size()) {
-        auto block = decompress2Word(compressed_data, offset);
-        decompressed.insert(decompressed.end(), block.begin(), block.end());
+size_t CPack::finish(uint8_t* dst, size_t dst_capacity) {
+    BitWriter out(dst, dst_capacity, stream_bits_);
+    encodeTail(stream_tail_, stream_tail_size_, out);
+    stream_bits_ = BitWriter::State();
+    stream_tail_size_ = 0;
+    return out.finish();
+}
+
+template <typename Dict>
+size_t CPack::decompressWords(Dict& dict, const uint8_t* src, size_t src_size,
+                              uint8_t* dst, size_t dst_capacity) {
+    dict.clear();
+    BitReader in(src, src_size);
+    size_t written = 0;
+    size_t partial = 0;
+
+    while (codeLength(in, partial) != 0) {
+        if (dst_capacity - written < (partial ? partial : WORD_SIZE)) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        written += decompress2Word(dict, in, dst + written);
     }
-    
-    return decompressed;
+
+    return written;
 }
 
+size_t CPack::decompressedSize(const uint8_t* src, size_t src_size) const {
+    BitReader in(src, src_size);
+    size_t size = 0;
+    size_t partial = 0;
 
-CPack::Compressed2Word CPack::compress2Word(const uint32_t& data) {
+    while (size_t length = codeLength(in, partial)) {
+        size += partial ? partial : WORD_SIZE;
+        // codes are at most 34 bits, except a partial word of up to 30
+        if (length > 32) {
+            in.skip(length - 32);
+            length = 32;
+        }
+        in.skip(length);
+    }
+
+    return size;
+}
+
+size_t CPack::codeLength(BitReader& in, size_t& partial) const {
+    size_t left = in.bitsLeft();
+    partial = 0;
+    if (left == 0) {
+        return 0;
+    }
+    // one bit padding up to the byte boundary
+    if (left < 8 && in.peek(left) == (1u << left) - 1) {
+        return 0;
+    }
+
+    size_t length = 0;
+    uint32_t prefix = in.peek(left < 4 ? left : 4) << (left < 4 ? 4 - left : 0);
+    switch (prefix >> 2) {
+        case 0b00: length = getCompBlkSize(ZERO_PATTERN); break;
+        case 0b01: length = getCompBlkSize(NONE_MATCH); break;
+        case 0b10: length = getCompBlkSize(MATCH_DICT); break;
+        default:
+            switch (prefix & 0b11) {
+                case 0b00: length = getCompBlkSize(PARTIAL_MATCH_2B); break;
+                case 0b01: length = getCompBlkSize(ZERO_UNMATCH); break;
+                case 0b10: length = getCompBlkSize(PARTIAL_MATCH_3B); break;
+                default:
+                    partial = left >= 6 ? (in.peek(6) & 0b11) : 0;
+                    if (partial == 0) {
+                        throw std::runtime_error("Invalid compressed data");
+                    }
+                    length = 6 + partial * 8;
+                    break;
+            }
+            break;
+    }
+
+    if (length > left) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return length;
+}
+
+
+template <typename Dict>
+CPack::Compressed2Word CPack::compress2Word(Dict& dict, const uint32_t& data) {
     Compressed2Word block;
     if (data == 0) {
         block.pattern = ZERO_PATTERN;
         return block;
     }
 
-    if (data&0x000000FF == 0) {
+    if ((data & 0xFFFFFF00) == 0) {
         block.pattern = ZERO_UNMATCH;
-        block.unmatch_data.push_back(data & 0xFF);
+        block.unmatch_size = 1;
+        block.unmatch_data[0] = data & 0xFF;
         return block;
     }
 
-    auto dict_entry = dict_.find_exact(data);
+    auto dict_entry = dict.find_exact(data);
     if (dict_entry) {
         block.pattern = MATCH_DICT;
-        block.dict_index = data;
+        block.dict_index = *dict_entry;
         return block;
     }
 
-    dict_entry = dict_.find_24bit(data);
+    dict_entry = dict.find_24bit(data);
     if (dict_entry) {
         block.pattern = PARTIAL_MATCH_3B;
-        block.dict_index = data;
-        block.unmatch_data.push_back(data & 0xFF);
+        block.dict_index = *dict_entry;
+        block.unmatch_size = 1;
+        block.unmatch_data[0] = data & 0xFF;
+        dict.insert(data);
         return block;
     }
 
-    dict_entry = dict_.find_16bit(data);
+    dict_entry = dict.find_16bit(data);
     if (dict_entry) {
         block.pattern = PARTIAL_MATCH_2B;
-        block.dict_index = data;
-        block.unmatch_data.push_back((data >> 0) & 0xFF);
-        block.unmatch_data.push_back((data >> 8) & 0xFF);
+        block.dict_index = *dict_entry;
+        block.unmatch_size = 2;
+        block.unmatch_data[0] = (data >> 0) & 0xFF;
+        block.unmatch_data[1] = (data >> 8) & 0xFF;
+        dict.insert(data);
         return block;
-    }   
+    }
 
-    dict_.insert(data, data);
+    dict.insert(data);
 
     block.pattern = NONE_MATCH;
 
+    block.unmatch_size = 4;
     for (int i = 0; i < 4; i++) {
-        block.unmatch_data.push_back((data >> (i * 8)) & 0xFF);
+        block.unmatch_data[i] = (data >> (i * 8)) & 0xFF;
     }
 
     return block;
 }
 
-CPack::Compressed2Word CPack::compress2Word(const std::vector<uint8_t>& data, size_t offset, size_t size) {
-    Compressed2Word block;
-    uint32_t doublewords = 0;  
-    // Check if all bytes in block are zero
-    bool all_zero = true;
-
-    for (size_t i = 0; i < size; ++i) {
-        if (data[offset + i] != 0) {
-            all_zero = false;
-        }
-        doublewords |= data[offset + i] << (i * 8);
-    }
-
-    block = compress2Word(doublewords);
-
-    //printf("compressed 2 word %s\n", printCompressed2Word(block).c_str());
-
-    return block;
-}
-
-std::vector<uint8_t> CPack::decompress2Word(const std::vector<uint8_t>& data, size_t& offset) {
-    if (offset >= data.size()) {
-        throw std::runtime_error("Invalid compressed data");
+void CPack::encode2Word(const Compressed2Word& block, BitWriter& out) const {
+    switch (block.pattern) {
+        case ZERO_PATTERN:
+            out.put(0b00, 2);
+            break;
+        case NONE_MATCH:
+            out.put(0b01, 2);
+            break;
+        case MATCH_DICT:
+            out.put(0b10, 2);
+            out.put(block.dict_index, index_bits_);
+            break;
+        case PARTIAL_MATCH_2B:
+            out.put(0b1100, 4);
+            out.put(block.dict_index, index_bits_);
+            break;
+        case ZERO_UNMATCH:
+            out.put(0b1101, 4);
+            break;
+        case PARTIAL_MATCH_3B:
+            out.put(0b1110, 4);
+            out.put(block.dict_index, index_bits_);
+            break;
     }
-    
-    uint8_t pattern = data[offset++];
-    std::vector<uint8_t> block;
-    uint32_t dict_index = 0;
 
-    for (int i = 0; i < 4; i++) {
-        dict_index |= data[offset++] << (i * 8);
+    for (uint8_t i = 0; i < block.unmatch_size; i++) {
+        out.put(block.unmatch_data[i], 8);
     }
+}
 
-    //printf("pattern: %s, dict_index: %0#x\n",
-    //getPatternName(pattern).c_str(), dict_index);
+template <typename Dict>
+size_t CPack::decompress2Word(Dict& dict, BitReader& in, uint8_t* dst) {
+    uint32_t word = 0;
+    uint32_t index = 0;
 
-    if (pattern == ZERO_PATTERN) {
-        // Zero block
-        block = std::vector<uint8_t>(4, 0);
-    } else if (pattern == NONE_MATCH) {
-        // Copy the next 4 bytes
-        for (int i = 0; i < 4 && offset < data.size(); ++i) {
-            block.push_back(data[offset++]);
+    // read the dictionary entry referenced by the code and replay the lru
+    // update the encoder did when it found it
+    auto lookup = [&]() {
+        index = in.get(index_bits_);
+        if (index >= dict.size()) {
+            throw std::runtime_error("Invalid dictionary index");
         }
-    } else if (pattern == MATCH_DICT) {
-        block = std::vector<uint8_t>(4, 0);
-        block[0] = dict_index & 0xFF;
-        block[1] = (dict_index >> 8) & 0xFF;
-        block[2] = (dict_index >> 16) & 0xFF;
-        block[3] = (dict_index >> 24) & 0xFF;
-    } else if (pattern == PARTIAL_MATCH_2B) {
-        block = std::vector<uint8_t>(4, 0);
-        block[0] = data[offset++];
-        block[1] = data[offset++];
-        dict_index = dict_index >> 16;
-        block[2] = dict_index & 0xFF;
-        block[3] = (dict_index >> 8) & 0xFF;
-
-    } else if (pattern == PARTIAL_MATCH_3B) {
-        block = std::vector<uint8_t>(4, 0);
-        block[0] = data[offset++];
-        dict_index = dict_index >> 8;
-        block[1] = dict_index & 0xFF;
-        block[2] = (dict_index >> 8) & 0xFF;
-        block[3] = (dict_index >> 16) & 0xFF;
-    } else {
-        throw std::runtime_error("Invalid pattern byte");
+        dict.touch(index);
+        return dict.at(index);
+    };
+
+    switch (in.get(2)) {
+        case 0b00:
+            // Zero word
+            break;
+        case 0b01:
+            for (int i = 0; i < 4; i++) {
+                word |= in.get(8) << (i * 8);
+            }
+            dict.insert(word);
+            break;
+        case 0b10:
+            word = lookup();
+            break;
+        default:
+            switch (in.get(2)) {
+                case 0b00:
+                    word = lookup() & 0xFFFF0000;
+                    word |= in.get(8);
+                    word |= in.get(8) << 8;
+                    dict.insert(word);
+                    break;
+                case 0b01:
+                    word = in.get(8);
+                    break;
+                case 0b10:
+                    word = lookup() & 0xFFFFFF00;
+                    word |= in.get(8);
+                    dict.insert(word);
+                    break;
+                default: {
+                    // trailing partial word
+                    size_t size = in.get(2);
+                    for (size_t i = 0; i < size; i++) {
+                        dst[i] = in.get(8);
+                    }
+                    return size;
+                }
+            }
+            break;
     }
-    
-    return block;
+
+    storeValue<uint32_t>(dst, word);
+    return WORD_SIZE;
 }
 
-} // namespace compression 
\ No newline at end of file
+} // namespace compression
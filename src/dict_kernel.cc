@@ -0,0 +1,108 @@
+// src/dict_kernel.cc
+#include "compression/common.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DICT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace dict_kernel {
+
+uint64_t matchScalar(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    uint64_t hits = 0;
+    for (size_t i = 0; i < n; i++) {
+        hits |= uint64_t((keys[i] & mask) == (key & mask)) << i;
+    }
+    return hits;
+}
+
+#if defined(DICT_KERNEL_X86)
+
+__attribute__((target("sse2")))
+uint64_t matchSSE2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    const __m128i k = _mm_set1_epi32(static_cast<int>(key & mask));
+    const __m128i m = _mm_set1_epi32(static_cast<int>(mask));
+    uint64_t hits = 0;
+    for (size_t i = 0; i < n; i += 4) {
+        __m128i v = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(keys + i)), m);
+        uint32_t bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, k)));
+        hits |= uint64_t(bits) << i;
+    }
+    return hits;
+}
+
+__attribute__((target("avx2")))
+uint64_t matchAVX2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    const __m256i k = _mm256_set1_epi32(static_cast<int>(key & mask));
+    const __m256i m = _mm256_set1_epi32(static_cast<int>(mask));
+    uint64_t hits = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), m);
+        uint32_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, k)));
+        hits |= uint64_t(bits) << i;
+    }
+    if (i < n) {
+        __m128i v = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(keys + i)),
+                                  _mm256_castsi256_si128(m));
+        uint32_t bits = _mm_movemask_ps(_mm_castsi128_ps(
+            _mm_cmpeq_epi32(v, _mm256_castsi256_si128(k))));
+        hits |= uint64_t(bits) << i;
+    }
+    return hits;
+}
+
+// the compares produce bitmaps directly, a full dictionary takes 4
+__attribute__((target("avx512f")))
+uint64_t matchAVX512(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    const __m512i k = _mm512_set1_epi32(static_cast<int>(key & mask));
+    const __m512i m = _mm512_set1_epi32(static_cast<int>(mask));
+    uint64_t hits = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_and_si512(_mm512_loadu_si512(keys + i), m);
+        hits |= uint64_t(_mm512_cmpeq_epi32_mask(v, k)) << i;
+    }
+    if (i < n) {
+        const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i v = _mm512_and_si512(_mm512_maskz_loadu_epi32(tail, keys + i), m);
+        hits |= uint64_t(_mm512_mask_cmpeq_epi32_mask(tail, v, k)) << i;
+    }
+    return hits;
+}
+
+MatchFn matcher() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return matchAVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return matchAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return matchSSE2;
+    }
+    return matchScalar;
+}
+
+#else
+
+uint64_t matchSSE2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    return matchScalar(keys, n, key, mask);
+}
+
+uint64_t matchAVX2(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    return matchScalar(keys, n, key, mask);
+}
+
+uint64_t matchAVX512(const uint32_t* keys, size_t n, uint32_t key, uint32_t mask) {
+    return matchScalar(keys, n, key, mask);
+}
+
+MatchFn matcher() {
+    return matchScalar;
+}
+
+#endif
+
+} // namespace dict_kernel
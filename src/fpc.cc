@@ -1,155 +1,220 @@
 #include "compression/fpc.h"
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace compression {
 
 FPC::FPC() = default;
 
-std::vector<uint8_t> FPC::compress(const std::vector<uint8_t>& data) {
-    std::vector<uint8_t> compressed;
-    
-    for (size_t i = 0; i < data.size(); i += 4) {  // Process 4-byte blocks
-        auto block = compressBlock(data, i);
-        
-        // Store pattern
-        compressed.push_back(block.pattern);
-        
-        // Store compressed data
-        compressed.insert(compressed.end(), block.data.begin(), block.data.end());
+size_t FPC::maxCompressedSize(size_t src_size) const {
+    // one pattern byte per word on top of the raw bytes
+    return src_size + (src_size + WORD_SIZE - 1) / WORD_SIZE;
+}
+
+size_t FPC::compress(const uint8_t* src, size_t src_size,
+                     uint8_t* dst, size_t dst_capacity) {
+    size_t written = 0;
+
+    for (size_t i = 0; i < src_size; i += WORD_SIZE) {  // Process 4-byte blocks
+        size_t block_size = std::min(WORD_SIZE, src_size - i);
+
+        if (dst_capacity - written >= MAX_BLOCK_SIZE) {
+            written += compressBlock(src + i, block_size, dst + written);
+        } else {
+            uint8_t block[MAX_BLOCK_SIZE];
+            size_t block_len = compressBlock(src + i, block_size, block);
+            if (dst_capacity - written < block_len) {
+                throw std::runtime_error("Output buffer too small");
+            }
+            std::memcpy(dst + written, block, block_len);
+            written += block_len;
+        }
     }
-    
-    return compressed;
+
+    return written;
 }
 
-std::vector<uint8_t> FPC::decompress(const std::vector<uint8_t>& compressed_data) {
-    std::vector<uint8_t> decompressed;
+size_t FPC::decompress(const uint8_t* src, size_t src_size,
+                       uint8_t* dst, size_t dst_capacity) {
+    size_t written = 0;
     size_t offset = 0;
-    
-    while (offset < compressed_data.size()) {
-        auto block = decompressBlock(compressed_data, offset);
-        decompressed.insert(decompressed.end(), block.begin(), block.end());
+
+    while (offset < src_size) {
+        written += decompressBlock(src, src_size, offset,
+                                   dst + written, dst_capacity - written);
+    }
+
+    return written;
+}
+
+size_t FPC::decompressedSize(const uint8_t* src, size_t src_size) const {
+    size_t size = 0;
+    size_t offset = 0;
+
+    while (offset < src_size) {
+        uint8_t pattern = src[offset++];
+        switch (pattern) {
+            case ZERO:
+                size += WORD_SIZE;
+                break;
+            case REPEATED_ZERO:
+                if (offset >= src_size) {
+                    throw std::runtime_error("Invalid compressed data");
+                }
+                size += src[offset++];
+                break;
+            case REPEATED_VALUE:
+                size += WORD_SIZE;
+                offset += 1;
+                break;
+            case HALF_PRECISION:
+                size += WORD_SIZE;
+                offset += 2;
+                break;
+            case UNCOMPRESSED:
+            default: {
+                size_t block_size = std::min(WORD_SIZE, src_size - offset);
+                size += block_size;
+                offset += block_size;
+                break;
+            }
+        }
+    }
+
+    if (offset > src_size) {
+        throw std::runtime_error("Invalid compressed data");
     }
-    
-    return decompressed;
+    return size;
 }
 
-FPC::CompressedBlock FPC::compressBlock(const std::vector<uint8_t>& data, size_t offset) {
-    CompressedBlock block;
-    block.pattern = detectPattern(data, offset);
-    
-    size_t remaining = std::min(size_t(4), data.size() - offset);
-    
-    switch (block.pattern) {
+size_t FPC::compressBlock(const uint8_t* word, size_t size, uint8_t* dst) {
+    uint8_t pattern = detectPattern(word, size);
+    dst[0] = pattern;
+
+    switch (pattern) {
         case ZERO:
             // No additional data needed
-            break;
-            
+            return 1;
+
         case REPEATED_ZERO:
             // Store zero count
-            block.data.push_back(remaining);
-            break;
-            
+            dst[1] = size;
+            return 2;
+
         case REPEATED_VALUE:
             // Store the repeated value
-            block.data.push_back(data[offset]);
-            break;
-            
+            dst[1] = word[0];
+            return 2;
+
         case HALF_PRECISION:
             // Store 2 bytes instead of 4
-            block.data.insert(block.data.end(),
-                            data.begin() + offset,
-                            data.begin() + offset + 2);
-            break;
-            
+            std::memcpy(dst + 1, word, 2);
+            return 3;
+
         case UNCOMPRESSED:
         default:
             // Store uncompressed data
-            block.data.insert(block.data.end(),
-                            data.begin() + offset,
-                            data.begin() + offset + remaining);
-            break;
+            std::memcpy(dst + 1, word, size);
+            return 1 + size;
     }
-    
-    return block;
 }
 
-std::vector<uint8_t> FPC::decompressBlock(const std::vector<uint8_t>& data, size_t& offset) {
-    if (offset >= data.size()) {
+size_t FPC::decompressBlock(const uint8_t* src, size_t src_size, size_t& offset,
+                            uint8_t* dst, size_t dst_capacity) {
+    if (offset >= src_size) {
         throw std::runtime_error("Invalid compressed data");
     }
-    
-    uint8_t pattern = data[offset++];
-    std::vector<uint8_t> block;
-    
+
+    uint8_t pattern = src[offset++];
+    size_t block_size = WORD_SIZE;
+    size_t payload = 0;
+
     switch (pattern) {
         case ZERO:
-            block = std::vector<uint8_t>(4, 0);
             break;
-            
         case REPEATED_ZERO:
-            block = std::vector<uint8_t>(data[offset++], 0);
+            payload = 1;
+            block_size = offset < src_size ? src[offset] : 0;
             break;
-            
-        case REPEATED_VALUE: {
-            uint8_t value = data[offset++];
-            block = std::vector<uint8_t>(4, value);
+        case REPEATED_VALUE:
+            payload = 1;
             break;
-        }
-            
-        case HALF_PRECISION: {
-            block.push_back(data[offset++]);
-            block.push_back(data[offset++]);
-            block.push_back(0);
-            block.push_back(0);
+        case HALF_PRECISION:
+            payload = 2;
             break;
-        }
-            
         case UNCOMPRESSED:
         default:
-            for (int i = 0; i < 4 && offset < data.size(); ++i) {
-                block.push_back(data[offset++]);
-            }
+            block_size = std::min(WORD_SIZE, src_size - offset);
+            payload = block_size;
             break;
     }
-    
-    return block;
+
+    if (src_size - offset < payload) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    if (dst_capacity < block_size) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    switch (pattern) {
+        case ZERO:
+        case REPEATED_ZERO:
+            std::memset(dst, 0, block_size);
+            break;
+
+        case REPEATED_VALUE:
+            std::memset(dst, src[offset], WORD_SIZE);
+            break;
+
+        case HALF_PRECISION:
+            dst[0] = src[offset];
+            dst[1] = src[offset + 1];
+            dst[2] = 0;
+            dst[3] = 0;
+            break;
+
+        case UNCOMPRESSED:
+        default:
+            std::memcpy(dst, src + offset, block_size);
+            break;
+    }
+
+    offset += payload;
+    return block_size;
 }
 
-uint8_t FPC::detectPattern(const std::vector<uint8_t>& data, size_t offset) {
-    size_t remaining = std::min(size_t(4), data.size() - offset);
-    
+uint8_t FPC::detectPattern(const uint8_t* word, size_t size) {
     // Check for zero pattern
     bool all_zero = true;
-    for (size_t i = 0; i < remaining; ++i) {
-        if (data[offset + i] != 0) {
+    for (size_t i = 0; i < size; ++i) {
+        if (word[i] != 0) {
             all_zero = false;
             break;
         }
     }
+
+    // a trailing partial word is either a run of zeros or stored as is
+    if (size < WORD_SIZE) {
+        return all_zero ? REPEATED_ZERO : UNCOMPRESSED;
+    }
+
     if (all_zero) return ZERO;
-    
+
     // Check for repeated value
     bool all_same = true;
-    for (size_t i = 1; i < remaining; ++i) {
-        if (data[offset + i] != data[offset]) {
+    for (size_t i = 1; i < size; ++i) {
+        if (word[i] != word[0]) {
             all_same = false;
             break;
         }
     }
     if (all_same) return REPEATED_VALUE;
-    
+
     // Check if upper half is all zeros (candidate for half precision)
-    bool upper_zero = true;
-    for (size_t i = 2; i < remaining; ++i) {
-        if (data[offset + i] != 0) {
-            upper_zero = false;
-            break;
-        }
-    }
-    if (upper_zero) return HALF_PRECISION;
-    
+    if (word[2] == 0 && word[3] == 0) return HALF_PRECISION;
+
     return UNCOMPRESSED;
 }
 
-} // namespace compression 
\ No newline at end of file
+} // namespace compression
@@ -1,91 +1,631 @@
 #include "compression/huffman.h"
-#include <functional>
-void HuffmanCompression::generateCodes(HuffmanNode* root, std::string code) {
-    if (!root) return;
-    if (!root->left && !root->right) {
-        huffmanCodes[root->data] = code;
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t TABLE_SIZE = size_t(1) << HUF_MAX_CODE_LENGTH;
+
+void storeSize(uint8_t* p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
     }
-    generateCodes(root->left, code + "0");
-    generateCodes(root->right, code + "1");
 }
 
-void HuffmanCompression::printout() {
-    for (auto pair : huffmanCodes) {
-        std::cout << pair.first << " : " << pair.second << std::endl;
+uint32_t loadSize(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+}
+
+// the 8 bytes at p as a big endian value
+uint64_t loadBigEndian(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, 8);
+    return __builtin_bswap64(value);
+}
+
+// MSB-first writer that collects codes in a 64-bit accumulator and stores
+// whole bytes eight at a time. The caller flushes before the accumulator
+// holds more than 64 bits, at least every 4 codes.
+class BitStreamWriter {
+private:
+    uint8_t* p_;
+    uint8_t* end_;
+    // pending bits live in the low bits_ bits of acc_
+    uint64_t acc_ = 0;
+    unsigned bits_ = 0;
+
+public:
+    BitStreamWriter(uint8_t* dst, uint8_t* end) : p_(dst), end_(end) {}
+
+    void put(uint32_t code, unsigned length) {
+        acc_ = (acc_ << length) | code;
+        bits_ += length;
+    }
+
+    void flush() {
+        if (bits_ < 8) {
+            return;
+        }
+        uint64_t value = __builtin_bswap64(acc_ << (64 - bits_));
+        size_t bytes = bits_ >> 3;
+        if (end_ - p_ >= 8) {
+            std::memcpy(p_, &value, 8);
+        } else {
+            std::memcpy(p_, &value, bytes);
+        }
+        p_ += bytes;
+        bits_ &= 7;
+    }
+
+    // write out the last bits padded with zeros, return the end
+    uint8_t* finish() {
+        flush();
+        if (bits_ > 0) {
+            *p_++ = static_cast<uint8_t>(acc_ << (8 - bits_));
+            bits_ = 0;
+        }
+        return p_;
+    }
+};
+
+} // namespace
+
+void HuffmanCompression::buildLengths(const uint32_t* frequencies, uint8_t* lengths) {
+    // Huffman's algorithm over node indexes: leaves are the symbols,
+    // internal nodes are numbered from HUF_NUM_SYMBOLS up as they are made
+    int parent[2 * HUF_NUM_SYMBOLS];
+    using Node = std::pair<uint64_t, int>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        lengths[s] = 0;
+        if (frequencies[s] > 0) {
+            heap.push({frequencies[s], s});
+        }
+    }
+    if (heap.size() < 2) {
+        // a single symbol still needs a one bit code
+        if (!heap.empty()) {
+            lengths[heap.top().second] = 1;
+        }
+        return;
+    }
+
+    int next = HUF_NUM_SYMBOLS;
+    while (heap.size() > 1) {
+        Node a = heap.top();
+        heap.pop();
+        Node b = heap.top();
+        heap.pop();
+        parent[a.second] = next;
+        parent[b.second] = next;
+        heap.push({a.first + b.first, next++});
+    }
+
+    // parents are made after their children, so depths resolve top down
+    int root = next - 1;
+    int depth[2 * HUF_NUM_SYMBOLS];
+    depth[root] = 0;
+    for (int node = root - 1; node >= HUF_NUM_SYMBOLS; node--) {
+        depth[node] = depth[parent[node]] + 1;
+    }
+
+    int symbols[HUF_NUM_SYMBOLS];
+    int count = 0;
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        if (frequencies[s] > 0) {
+            symbols[count++] = s;
+            lengths[s] = static_cast<uint8_t>(std::min(depth[parent[s]] + 1, HUF_MAX_CODE_LENGTH));
+        }
+    }
+
+    // Clamping long codes overfills the code space, measured here in units
+    // of 2^-HUF_MAX_CODE_LENGTH. Lengthen the rarest short codes until it
+    // fits, then spend what is left on shortening the most frequent codes.
+    std::stable_sort(symbols, symbols + count, [&](int a, int b) {
+        return frequencies[a] > frequencies[b];
+    });
+    auto unit = [&](int s) { return uint32_t(1) << (HUF_MAX_CODE_LENGTH - lengths[s]); };
+    uint32_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total += unit(symbols[i]);
+    }
+    while (total > TABLE_SIZE) {
+        // lengthening the longest code below the limit costs the least
+        int best = -1;
+        for (int i = count - 1; i >= 0; i--) {
+            int s = symbols[i];
+            if (lengths[s] < HUF_MAX_CODE_LENGTH && (best < 0 || lengths[s] > lengths[best])) {
+                best = s;
+            }
+        }
+        total -= unit(best) / 2;
+        lengths[best]++;
+    }
+    bool changed = true;
+    while (total < TABLE_SIZE && changed) {
+        changed = false;
+        for (int i = 0; i < count && total < TABLE_SIZE; i++) {
+            int s = symbols[i];
+            if (lengths[s] > 1 && total + unit(s) <= TABLE_SIZE) {
+                total += unit(s);
+                lengths[s]--;
+                changed = true;
+            }
+        }
+    }
+}
+
+void HuffmanCompression::Code::build(const uint32_t* frequencies) {
+    buildLengths(frequencies, lengths);
+    maxSymbol = -1;
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        if (lengths[s] > 0) {
+            maxSymbol = s;
+        }
     }
+    buildCodes();
+    ready = true;
 }
 
-HuffmanNode* HuffmanCompression::buildTree(const std::string& input) {
-    std::unordered_map<char, unsigned> frequencies;
-    for (char c : input) frequencies[c]++;
-    // use priority queue to store nodes with lowest frequency at the top
-    std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, CompareNodes> minHeap;
+void HuffmanCompression::Code::buildCodes() {
+    // first code of every length, consecutive within a length
+    uint16_t count[HUF_MAX_CODE_LENGTH + 1] = {};
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        count[lengths[s]]++;
+    }
+    count[0] = 0;
+    uint16_t next[HUF_MAX_CODE_LENGTH + 1] = {};
+    uint16_t code = 0;
+    for (int length = 1; length <= HUF_MAX_CODE_LENGTH; length++) {
+        code = static_cast<uint16_t>((code + count[length - 1]) << 1);
+        next[length] = code;
+    }
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        codes[s] = lengths[s] ? next[lengths[s]]++ : 0;
+    }
+}
+
+void HuffmanCompression::Code::buildDecodeTable() {
+    // every index whose top bits are a code decodes to that code's symbol
+    decodeTable.resize(TABLE_SIZE);
+    for (int s = 0; s <= maxSymbol; s++) {
+        if (lengths[s] == 0) {
+            continue;
+        }
+        unsigned shift = HUF_MAX_CODE_LENGTH - lengths[s];
+        DecodeEntry entry = {static_cast<uint8_t>(s), lengths[s]};
+        std::fill(decodeTable.begin() + (codes[s] << shift),
+                  decodeTable.begin() + ((codes[s] + 1) << shift), entry);
+    }
+}
 
-    // the leaf nodes are pushed into the minHeap
-    // the nodes are sorted based on their frequency
-    for (auto pair : frequencies) {
-        minHeap.push(new HuffmanNode(pair.first, pair.second));
+size_t HuffmanCompression::Code::write(uint8_t* dst, size_t dst_capacity) const {
+    if (dst_capacity < tableSize()) {
+        throw std::runtime_error("Output buffer too small");
     }
-    // build the huffman tree
-    // the two nodes with the lowest frequency are combined into a single node
-    // the combined node is then pushed back into the minHeap
-    while (minHeap.size() > 1) {
-        HuffmanNode *left = minHeap.top(); minHeap.pop();
-        HuffmanNode *right = minHeap.top(); minHeap.pop();
-        
-        HuffmanNode *parent = new HuffmanNode('\0', left->frequency + right->frequency);
-        parent->left = left;
-        parent->right = right;
-        minHeap.push(parent);
+    uint8_t* op = dst;
+    *op++ = static_cast<uint8_t>(maxSymbol);
+    for (int s = 0; s <= maxSymbol; s += 2) {
+        uint8_t high = s + 1 <= maxSymbol ? lengths[s + 1] : 0;
+        *op++ = static_cast<uint8_t>(lengths[s] | (high << 4));
     }
-    // return the root of the huffman tree
-    // user can use this root to generate huffman codes
-    return minHeap.top();
+    return op - dst;
 }
 
-std::string HuffmanCompression::compress(const std::string& input) {
-    // build the huffman tree
-    root = buildTree(input);
-    // generate huffman codes
-    generateCodes(root, "");
+size_t HuffmanCompression::Code::read(const uint8_t* src, size_t src_size) {
+    ready = false;
+    if (src_size == 0) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    maxSymbol = src[0];
+    if (src_size < tableSize()) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+
+    // the lengths must fill the code space exactly so that every table
+    // index decodes to a symbol
+    std::fill(lengths, lengths + HUF_NUM_SYMBOLS, 0);
+    uint32_t total = 0;
+    for (int s = 0; s <= maxSymbol; s++) {
+        uint8_t length = (src[1 + s / 2] >> (s % 2 * 4)) & 0xF;
+        if (length > HUF_MAX_CODE_LENGTH) {
+            throw std::runtime_error("Invalid code lengths");
+        }
+        lengths[s] = length;
+        total += length ? uint32_t(TABLE_SIZE) >> length : 0;
+    }
+    if (total != TABLE_SIZE) {
+        throw std::runtime_error("Invalid code lengths");
+    }
+
+    buildCodes();
+    buildDecodeTable();
+    ready = true;
+    return tableSize();
+}
+
+uint8_t* HuffmanCompression::encodeStream(const Code& code, const uint8_t* src, size_t src_size,
+                                          uint8_t* dst, uint8_t* dst_end) {
+    const uint8_t* lengths = code.lengths;
+    const uint16_t* codes = code.codes;
+    BitStreamWriter writer(dst, dst_end);
+    size_t i = 0;
+    for (; i + 4 <= src_size; i += 4) {
+        writer.put(codes[src[i]], lengths[src[i]]);
+        writer.put(codes[src[i + 1]], lengths[src[i + 1]]);
+        writer.put(codes[src[i + 2]], lengths[src[i + 2]]);
+        writer.put(codes[src[i + 3]], lengths[src[i + 3]]);
+        writer.flush();
+    }
+    for (; i < src_size; i++) {
+        writer.put(codes[src[i]], lengths[src[i]]);
+    }
+    return writer.finish();
+}
+
+uint8_t* HuffmanCompression::encodeSymbols(const Code& code, const uint8_t* src, size_t src_size,
+                                           const size_t* stream_bytes, uint8_t* dst, uint8_t* dst_end) {
+    if (src_size < FOUR_STREAM_MIN) {
+        return encodeStream(code, src, src_size, dst, dst_end);
+    }
+
+    // streams may store past their own end, the next stream overwrites it
+    size_t segment = (src_size + 3) / 4;
+    uint8_t* op = dst + JUMP_TABLE_SIZE;
+    for (int k = 0; k < 4; k++) {
+        if (k < 3) {
+            storeSize(dst + 4 * k, static_cast<uint32_t>(stream_bytes[k]));
+        }
+        size_t begin = k * segment;
+        op = encodeStream(code, src + begin, std::min(segment, src_size - begin), op, dst_end);
+    }
+    return op;
+}
+
+size_t HuffmanCompression::streamBytes(const Code& code, const uint8_t* src, size_t src_size,
+                                       size_t* stream_bytes) {
+    size_t num_streams = src_size < FOUR_STREAM_MIN ? 1 : 4;
+    size_t segment = (src_size + num_streams - 1) / num_streams;
+    size_t total = num_streams == 1 ? 0 : JUMP_TABLE_SIZE;
+    for (size_t k = 0; k < num_streams; k++) {
+        uint64_t bits = 0;
+        for (size_t i = k * segment; i < std::min(src_size, (k + 1) * segment); i++) {
+            bits += code.lengths[src[i]];
+        }
+        stream_bytes[k] = (bits + 7) / 8;
+        total += stream_bytes[k];
+    }
+    return total;
+}
+
+void HuffmanCompression::decodeStream(const DecodeEntry* table, const uint8_t* ip, unsigned used,
+                                      const uint8_t* src_end, uint8_t* op, uint8_t* oend) {
+    // four symbols per 8-byte load while the load stays inside the input:
+    // at most 7 bits of the first byte are used plus 4 codes of 11 bits
+    while (oend - op >= 4 && src_end - ip >= 8) {
+        uint64_t bits = loadBigEndian(ip) << used;
+        for (int k = 0; k < 4; k++) {
+            DecodeEntry entry = table[bits >> (64 - HUF_MAX_CODE_LENGTH)];
+            *op++ = entry.symbol;
+            bits <<= entry.length;
+            used += entry.length;
+        }
+        ip += used >> 3;
+        used &= 7;
+    }
+
+    // the rest one symbol at a time from a zero padded copy
+    while (op < oend) {
+        if (ip >= src_end) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        uint8_t tail[8] = {};
+        std::memcpy(tail, ip, std::min<size_t>(8, src_end - ip));
+        uint64_t bits = loadBigEndian(tail) << used;
+        DecodeEntry entry = table[bits >> (64 - HUF_MAX_CODE_LENGTH)];
+        *op++ = entry.symbol;
+        used += entry.length;
+        ip += used >> 3;
+        used &= 7;
+    }
+    if (ip + (used > 0) > src_end) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+}
+
+void HuffmanCompression::decodeSymbols(const Code& code, const uint8_t* src, const uint8_t* src_end,
+                                       uint8_t* dst, size_t size) {
+    const DecodeEntry* table = code.decodeTable.data();
+    if (size < FOUR_STREAM_MIN) {
+        decodeStream(table, src, 0, src_end, dst, dst + size);
+        return;
+    }
+
+    // stream bounds from the jump table
+    if (src_end - src < static_cast<ptrdiff_t>(JUMP_TABLE_SIZE)) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    const uint8_t* begin[5];
+    begin[0] = src + JUMP_TABLE_SIZE;
+    for (int k = 0; k < 3; k++) {
+        size_t bytes = loadSize(src + 4 * k);
+        if (static_cast<size_t>(src_end - begin[k]) < bytes) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        begin[k + 1] = begin[k] + bytes;
+    }
+    begin[4] = src_end;
+
+    // stream state: input position, bits of its first byte consumed and
+    // output position
+    struct Stream {
+        const uint8_t* ip;
+        unsigned used;
+        uint8_t* op;
+    };
+    size_t segment = (size + 3) / 4;
+    Stream streams[4];
+    for (int k = 0; k < 4; k++) {
+        streams[k] = {begin[k], 0, dst + k * segment};
+    }
+    uint8_t* const oend = dst + size;
+
+    // The four streams are independent, so their lookups overlap. Every
+    // round takes four symbols from each; the last segment is the
+    // shortest, so its output bounds all of them. A load may run into the
+    // next stream's bytes, which only matter for corrupt data, caught by
+    // the bounds check of the tails.
+    Stream s0 = streams[0], s1 = streams[1], s2 = streams[2], s3 = streams[3];
+    while (oend - s3.op >= 4 &&
+           src_end - s0.ip >= 8 && src_end - s1.ip >= 8 &&
+           src_end - s2.ip >= 8 && src_end - s3.ip >= 8) {
+        uint64_t bits0 = loadBigEndian(s0.ip) << s0.used;
+        uint64_t bits1 = loadBigEndian(s1.ip) << s1.used;
+        uint64_t bits2 = loadBigEndian(s2.ip) << s2.used;
+        uint64_t bits3 = loadBigEndian(s3.ip) << s3.used;
+        // one symbol of every stream per step, unrolled by hand so the
+        // stream state stays in registers
+        auto step = [table](Stream& stream, uint64_t& bits, int n) {
+            DecodeEntry entry = table[bits >> (64 - HUF_MAX_CODE_LENGTH)];
+            stream.op[n] = entry.symbol;
+            bits <<= entry.length;
+            stream.used += entry.length;
+        };
+        for (int n = 0; n < 4; n++) {
+            step(s0, bits0, n);
+            step(s1, bits1, n);
+            step(s2, bits2, n);
+            step(s3, bits3, n);
+        }
+        for (Stream* stream : {&s0, &s1, &s2, &s3}) {
+            stream->op += 4;
+            stream->ip += stream->used >> 3;
+            stream->used &= 7;
+        }
+    }
+    streams[0] = s0;
+    streams[1] = s1;
+    streams[2] = s2;
+    streams[3] = s3;
+
+    for (int k = 0; k < 4; k++) {
+        uint8_t* segment_end = k < 3 ? dst + (k + 1) * segment : oend;
+        decodeStream(table, streams[k].ip, streams[k].used, begin[k + 1], streams[k].op, segment_end);
+    }
+}
+
+size_t HuffmanCompression::compress(const uint8_t* src, size_t src_size,
+                                    uint8_t* dst, size_t dst_capacity) {
+    if (src_size > UINT32_MAX) {
+        throw std::runtime_error("Input too large");
+    }
+    if (dst_capacity < HEADER_SIZE) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    storeSize(dst, static_cast<uint32_t>(src_size));
+
+    uint32_t frequencies[HUF_NUM_SYMBOLS] = {};
+    for (size_t i = 0; i < src_size; i++) {
+        frequencies[src[i]]++;
+    }
+    code_.build(frequencies);
+
+    int num_symbols = 0;
+    uint64_t total_bits = 0;
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        if (frequencies[s] > 0) {
+            num_symbols++;
+            total_bits += uint64_t(frequencies[s]) * code_.lengths[s];
+        }
+    }
+
+    if (num_symbols == 1) {
+        if (dst_capacity < HEADER_SIZE + 1) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        dst[4] = RLE;
+        dst[5] = static_cast<uint8_t>(code_.maxSymbol);
+        return HEADER_SIZE + 1;
+    }
+
+    // the streams only cost their padding and jump table on top, skip
+    // sizing them when the input is stored anyway
+    size_t huffman_size = code_.tableSize() + (total_bits + 7) / 8;
+    size_t stream_bytes[4];
+    if (num_symbols > 1 && huffman_size < src_size) {
+        huffman_size = code_.tableSize() + streamBytes(code_, src, src_size, stream_bytes);
+    }
+    if (num_symbols == 0 || huffman_size >= src_size) {
+        if (dst_capacity - HEADER_SIZE < src_size) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        dst[4] = RAW;
+        if (src_size > 0) {
+            std::memcpy(dst + HEADER_SIZE, src, src_size);
+        }
+        return HEADER_SIZE + src_size;
+    }
+    if (dst_capacity - HEADER_SIZE < huffman_size) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    dst[4] = HUFFMAN;
+    uint8_t* op = dst + HEADER_SIZE;
+    op += code_.write(op, huffman_size);
+    return encodeSymbols(code_, src, src_size, stream_bytes, op, dst + HEADER_SIZE + huffman_size) - dst;
+}
+
+size_t HuffmanCompression::decompress(const uint8_t* src, size_t src_size,
+                                      uint8_t* dst, size_t dst_capacity) {
+    if (src_size < HEADER_SIZE) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    size_t size = loadSize(src);
+    if (size > dst_capacity) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    const uint8_t* ip = src + HEADER_SIZE;
+    const uint8_t* const iend = src + src_size;
+
+    if (src[4] == RAW) {
+        if (static_cast<size_t>(iend - ip) != size) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        if (size > 0) {
+            std::memcpy(dst, ip, size);
+        }
+        return size;
+    }
+    if (src[4] == RLE) {
+        if (iend - ip != 1) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        std::memset(dst, *ip, size);
+        return size;
+    }
+    if (src[4] != HUFFMAN) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+
+    ip += code_.read(ip, iend - ip);
+    decodeSymbols(code_, ip, iend, dst, size);
+    return size;
+}
+
+size_t HuffmanCompression::decompressedSize(const uint8_t* src, size_t src_size) {
+    if (src_size < HEADER_SIZE) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return loadSize(src);
+}
+
+void HuffmanCompression::buildTable(const uint8_t* sample, size_t sample_size) {
+    // one extra count each keeps every byte value codable
+    uint32_t frequencies[HUF_NUM_SYMBOLS];
+    std::fill(frequencies, frequencies + HUF_NUM_SYMBOLS, 1);
+    for (size_t i = 0; i < sample_size; i++) {
+        if (frequencies[sample[i]] < UINT32_MAX) {
+            frequencies[sample[i]]++;
+        }
+    }
+    table_.build(frequencies);
+    table_.buildDecodeTable();
+}
+
+size_t HuffmanCompression::writeTable(uint8_t* dst, size_t dst_capacity) const {
+    if (!table_.ready) {
+        throw std::runtime_error("No table");
+    }
+    return table_.write(dst, dst_capacity);
+}
+
+size_t HuffmanCompression::readTable(const uint8_t* src, size_t src_size) {
+    return table_.read(src, src_size);
+}
+
+size_t HuffmanCompression::compressWithTable(const uint8_t* src, size_t src_size,
+                                             uint8_t* dst, size_t dst_capacity) const {
+    if (!table_.ready) {
+        throw std::runtime_error("No table");
+    }
+    if (src_size > UINT32_MAX) {
+        throw std::runtime_error("Input too large");
+    }
 
-    printout();
+    // a loaded table may lack symbols
+    uint8_t min_length = HUF_MAX_CODE_LENGTH;
+    for (size_t i = 0; i < src_size; i++) {
+        min_length = std::min(min_length, table_.lengths[src[i]]);
+    }
+    if (min_length == 0) {
+        throw std::runtime_error("Symbol not in table");
+    }
+    size_t stream_bytes[4];
+    size_t size = 4 + streamBytes(table_, src, src_size, stream_bytes);
+    if (dst_capacity < size) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    storeSize(dst, static_cast<uint32_t>(src_size));
+    return encodeSymbols(table_, src, src_size, stream_bytes, dst + 4, dst + size) - dst;
+}
 
-    std::string compressed;
-    for (char c : input) {
-        compressed += huffmanCodes[c];
+size_t HuffmanCompression::decompressWithTable(const uint8_t* src, size_t src_size,
+                                               uint8_t* dst, size_t dst_capacity) const {
+    if (!table_.ready) {
+        throw std::runtime_error("No table");
     }
+    if (src_size < 4) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    size_t size = loadSize(src);
+    if (size > dst_capacity) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    decodeSymbols(table_, src + 4, src + src_size, dst, size);
+    return size;
+}
+
+std::string HuffmanCompression::compress(const std::string& input) {
+    std::string compressed(maxCompressedSize(input.size()), '\0');
+    size_t size = compress(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                           reinterpret_cast<uint8_t*>(&compressed[0]), compressed.size());
+    compressed.resize(size);
     return compressed;
 }
 
 std::string HuffmanCompression::decompress(const std::string& compressed) {
-    std::string decompressed;
-    HuffmanNode* current = root;
-    
-    for (char bit : compressed) {
-        // walk the tree based on the bit value
-        if (bit == '0') current = current->left;
-        else current = current->right;
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(compressed.data());
+    std::string decompressed(decompressedSize(src, compressed.size()), '\0');
+    decompress(src, compressed.size(),
+               reinterpret_cast<uint8_t*>(&decompressed[0]), decompressed.size());
+    return decompressed;
+}
 
-        // when we reach a leaf node, append the character to the decompressed string
-        if (!current->left && !current->right) {
-            decompressed += current->data;
-            current = root;
+void HuffmanCompression::printout() {
+    for (int s = 0; s < HUF_NUM_SYMBOLS; s++) {
+        if (code_.lengths[s] == 0) {
+            continue;
         }
+        std::cout << static_cast<char>(s) << " : ";
+        for (int bit = code_.lengths[s] - 1; bit >= 0; bit--) {
+            std::cout << ((code_.codes[s] >> bit) & 1);
+        }
+        std::cout << std::endl;
     }
+}
 
-    removeTree();
-    return decompressed;
+namespace compression {
+
+size_t HuffmanCodec::compress(const uint8_t* src, size_t src_size,
+                              uint8_t* dst, size_t dst_capacity) {
+    return huffman_.compress(src, src_size, dst, dst_capacity);
 }
 
-void HuffmanCompression::removeTree() {
-    // traverse the tree in post-order and delete each node
-    std::function<void(HuffmanNode*)> deleteTree = [&](HuffmanNode* node) {
-        if (!node) return;
-        deleteTree(node->left);
-        deleteTree(node->right);
-        delete node;
-    };
-    deleteTree(root);
-    root = nullptr;
-}
\ No newline at end of file
+size_t HuffmanCodec::decompress(const uint8_t* src, size_t src_size,
+                                uint8_t* dst, size_t dst_capacity) {
+    return huffman_.decompress(src, src_size, dst, dst_capacity);
+}
+
+} // namespace compression
@@ -1,179 +1,612 @@
 // src/lz4.cc
 #include "compression/lz4.h"
 #include <cstring>
+#include <stdexcept>
 
-std::vector<char> LZ4Compressor::compress(const std::vector<char>& input) {
-    size_t inputSize = input.size();
-    std::vector<char> output;
-
-    bool init = true;
-
-    size_t globalLastMatchPosition = 0;
-
-    for (size_t i = 0; i < inputSize;) {
-        bool isMatch = false;
-        // get the hash value
-        int hashValue = hashFunction(input.data(), i, inputSize);
-        // get the last position of the match
-        int matchLastPosition = hashTable[hashValue];
-        printf("i: %ld, hashValue: %d, matchLastPosition: %d\n", i, hashValue, matchLastPosition);
-
-        if (matchLastPosition != -1) {
-            // find the match length
-            int matchLength = findMatchLength(input.data(), inputSize, i, matchLastPosition);
-            int matchOffset = i - matchLastPosition;
-            
-            if (matchLength >= LZ4_MIN_MATCH) {
-                
-                // create a block
-                LZ4Block block;
-
-                // compute literal length
-                int literalLength;
-                if (init == true) {
-                    literalLength = i;
-                    init = false;
-                } else {
-                    literalLength = i - matchLastPosition - matchLength;
-                }
-                printf("literalLength: %d, matchLength: %d\n", literalLength, matchLength);
-                // encode the token
-                block.token = MIN(literalLength, 15U) | MIN(matchLength - 4, 15U) << 4;
-
-                if (literalLength > 15U) {
-                    int tmpLiteralLength = literalLength - 15U;
-                    while (tmpLiteralLength > 0) {
-                        block.literalLengths.push_back(tmpLiteralLength & 0xFF);
-                        tmpLiteralLength = tmpLiteralLength -255;
-                    }
-                }
+namespace {
 
-                if (matchLength > 19U) {
-                    // at least match 4 bytes
-                    int tmpMatchLength = matchLength - 19U;
-                    while (tmpMatchLength > 0) {
-                        block.matchLengths.push_back(tmpMatchLength & 0xFF);
-                        tmpMatchLength = tmpMatchLength -255;
-                    }
-                }
+// positions probed without a match before the step grows by one
+constexpr unsigned SKIP_TRIGGER = 6;
 
-                for (int j = i - literalLength; j < i; ++j) {
-                    block.literals.push_back(input[j]);
-                }
+uint32_t load32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
 
-                block.matchOffset = matchOffset;
+// bytes the decoder's wide copies may write past the end of a copy, and
+// read past the end of its source
+constexpr size_t WILD_COPY_SLACK = 16;
+
+// copy [src, src + end - dst) in 16-byte steps, may overrun end by up to
+// 15 bytes; src and dst must be at least 16 bytes apart
+inline void wildCopy16(uint8_t* dst, const uint8_t* src, uint8_t* end) {
+    do {
+        std::memcpy(dst, src, 16);
+        dst += 16;
+        src += 16;
+    } while (dst < end);
+}
 
-                block.print();
+inline void wildCopy8(uint8_t* dst, const uint8_t* src, uint8_t* end) {
+    do {
+        std::memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+    } while (dst < end);
+}
 
-                block.encode(output);
+// write the length bytes at op - offset to op, which may overlap
+void copyMatch(uint8_t* op, size_t offset, size_t length, uint8_t* oend) {
+    const uint8_t* match = op - offset;
+    uint8_t* end = op + length;
 
-                // update the hash table
-                hashTable[hashValue] = i;
+    if (static_cast<size_t>(oend - op) < length + WILD_COPY_SLACK) {
+        // too close to the end of the output for wide stores
+        for (size_t i = 0; i < length; i++) {
+            op[i] = match[i];
+        }
+        return;
+    }
 
-                i += matchLength;
+    if (offset >= 16) {
+        wildCopy16(op, match, end);
+    } else if (offset >= 8) {
+        wildCopy8(op, match, end);
+    } else {
+        // replicate the pattern byte by byte until the source is a whole
+        // number of periods and at least 8 bytes behind, then copy wide
+        size_t distance = (8 + offset - 1) / offset * offset;
+        size_t head = std::min(distance, length);
+        for (size_t i = 0; i < head; i++) {
+            op[i] = match[i];
+        }
+        if (head < length) {
+            wildCopy8(op + head, op + head - distance, end);
+        }
+    }
+}
 
-                globalLastMatchPosition = i;
-            }
+// length beyond a 15 nibble, in 255-byte steps
+uint8_t* writeLength(uint8_t* op, size_t length) {
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = static_cast<uint8_t>(length);
+    return op;
+}
+
+size_t readLength(const uint8_t*& ip, const uint8_t* iend) {
+    size_t length = 0;
+    uint8_t byte;
+    do {
+        if (ip >= iend) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+// write one sequence; match_length 0 writes the closing literals-only one
+uint8_t* writeSequence(uint8_t* op, uint8_t* oend, const uint8_t* literals,
+                       size_t literal_length, size_t offset, size_t match_length) {
+    size_t needed = 1 + literal_length / 255 + 1 + literal_length +
+                    (match_length ? 2 + match_length / 255 + 1 : 0);
+    if (static_cast<size_t>(oend - op) < needed) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+    if (literal_length >= 15) {
+        op = writeLength(op, literal_length - 15);
+    }
+    if (literal_length > 0) {
+        std::memcpy(op, literals, literal_length);
+        op += literal_length;
+    }
+
+    if (match_length) {
+        *op++ = offset & 0xFF;
+        *op++ = (offset >> 8) & 0xFF;
+        size_t length = match_length - LZ4_MIN_MATCH;
+        *token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+        if (length >= 15) {
+            op = writeLength(op, length - 15);
         }
+    }
+    return op;
+}
+
+// hash table of the fast mode: entry - offset is the last position with
+// that hash relative to the block's base, entries below offset are empty
+template <typename Entry>
+struct PositionTable {
+    Entry* entries;
+    uint32_t offset;
+    int shift;
+
+    uint32_t hash(const uint8_t* p) const {
+        return (load32(p) * MAGIC_NUMBER) >> shift;
+    }
+
+    void put(uint32_t hash, size_t pos) {
+        entries[hash] = static_cast<Entry>(pos + offset);
+    }
+};
+
+// enter every position of [begin, end) relative to base into the table
+template <typename Entry>
+void hashRange(PositionTable<Entry>& table, const uint8_t* base, size_t begin, size_t end) {
+    for (size_t pos = begin; pos + LZ4_MIN_MATCH <= end; pos++) {
+        table.put(table.hash(base + pos), pos);
+    }
+}
+
+// compress the src_size bytes at base + start, the start bytes before them
+// are history already in the table
+template <typename Entry>
+size_t compressFast(PositionTable<Entry>& table, int acceleration,
+                    const uint8_t* base, size_t start, size_t src_size,
+                    uint8_t* dst, size_t dst_capacity) {
+    const uint8_t* ip = base + start;
+    const uint8_t* anchor = ip;
+    const uint8_t* const iend = ip + src_size;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dst_capacity;
 
-        if (!isMatch) {
-            int hashValue = hashFunction(input.data(), i, inputSize);
-            if (hashTable[hashValue] == -1) {
-                hashTable[hashValue] = i;
+    // inputs this short are stored as literals
+    if (src_size > static_cast<size_t>(LZ4_MF_LIMIT)) {
+        const uint8_t* const mflimit = iend - LZ4_MF_LIMIT;
+        const uint8_t* const matchlimit = iend - LZ4_LAST_LITERALS;
+
+        table.put(table.hash(ip), start);
+        ip++;
+
+        while (ip <= mflimit) {
+            // every probed position replaces the table entry of its hash;
+            // the step grows by one every 1 << SKIP_TRIGGER misses, scaled by
+            // the acceleration, so incompressible data is skipped quickly
+            const uint8_t* match = nullptr;
+            unsigned attempts = static_cast<unsigned>(acceleration) << SKIP_TRIGGER;
+            while (ip <= mflimit) {
+                uint32_t hash = table.hash(ip);
+                uint32_t entry = table.entries[hash];
+                table.put(hash, ip - base);
+                if (entry >= table.offset) {
+                    const uint8_t* candidate = base + (entry - table.offset);
+                    if (ip - candidate <= LZ4_MAX_DISTANCE && load32(candidate) == load32(ip)) {
+                        match = candidate;
+                        break;
+                    }
+                }
+                ip += attempts++ >> SKIP_TRIGGER;
+            }
+            if (!match) {
+                break;
+            }
+
+            // take over the literals the match also covers
+            while (ip > anchor && match > base && ip[-1] == match[-1]) {
+                ip--;
+                match--;
+            }
+
+            size_t match_length = LZ4_MIN_MATCH +
+                LZ4Compressor::findMatchLength(ip + LZ4_MIN_MATCH, match + LZ4_MIN_MATCH, matchlimit);
+            op = writeSequence(op, oend, anchor, ip - anchor, ip - match, match_length);
+            ip += match_length;
+            anchor = ip;
+
+            // refresh the table inside the match so the next search sees it
+            if (ip <= mflimit) {
+                table.put(table.hash(ip - 2), ip - 2 - base);
             }
-            
-            printf("i: %ld does not match.\n", i);
-
-            ++i;
-        }
-    }
-
-    /*
-    * even here we take care of the last block
-    * if the last block is not a match, since token contains match length,
-    * which start from 4, the last block dont know how to handle it.compress
-    * since in real case, might zero match in last block.
-    * TODO: need to handle this case.
-    */
-    if (globalLastMatchPosition < inputSize) {
-        // add the last block
-        LZ4Block block;
-        int literalLength = inputSize - globalLastMatchPosition;
-        printf("last block literalLength: %d\n", literalLength);
-        block.token = literalLength & 0xF;
-        if (literalLength > 15U) {
-            int tmpLiteralLength = literalLength - 15U;
-            while (tmpLiteralLength > 0) {
-                block.literalLengths.push_back(tmpLiteralLength & 0xFF);
-                tmpLiteralLength = tmpLiteralLength -255;
+        }
+    }
+
+    op = writeSequence(op, oend, anchor, iend - anchor, 0, 0);
+    return op - dst;
+}
+
+} // namespace
+
+size_t LZ4Compressor::compress(const uint8_t* src, size_t src_size,
+                               uint8_t* dst, size_t dst_capacity) {
+    return compressWithPrefix(src, src_size, dst, dst_capacity, 0);
+}
+
+size_t LZ4Compressor::compressSmall(const uint8_t* src, size_t src_size,
+                                    uint8_t* dst, size_t dst_capacity, int acceleration) {
+    if (src_size > LZ4_SMALL_MAX_INPUT) {
+        throw std::runtime_error("Input too large");
+    }
+    // about one entry per input byte; positions are stored plus one so
+    // that zero is empty and 65534 still fits
+    int hash_log = 8;
+    while (hash_log < LZ4_SMALL_HASH_LOG && (size_t(1) << hash_log) < src_size) {
+        hash_log++;
+    }
+    uint16_t entries[1 << LZ4_SMALL_HASH_LOG];
+    std::fill(entries, entries + (1 << hash_log), 0);
+
+    PositionTable<uint16_t> table{entries, 1, 32 - hash_log};
+    return compressFast(table, std::max(1, acceleration), src, 0, src_size, dst, dst_capacity);
+}
+
+size_t LZ4Compressor::compressWithPrefix(const uint8_t* src, size_t src_size,
+                                         uint8_t* dst, size_t dst_capacity,
+                                         size_t prefix_size) {
+    if (src_size > LZ4_MAX_INPUT_SIZE) {
+        throw std::runtime_error("Input too large");
+    }
+    // only the last window of the prefix can be matched
+    prefix_size = std::min(prefix_size, static_cast<size_t>(WINDOW_SIZE));
+    resetTable(prefix_size + src_size);
+    tableHoldsDictionary_ = false;
+
+    const uint8_t* base = src - prefix_size;
+    if (mode_ == Mode::HC) {
+        return compressHC(base, prefix_size, src_size, dst, dst_capacity, 0);
+    }
+    PositionTable<uint32_t> table{hashTable, tableOffset_, 32 - HASH_LOG};
+    hashRange(table, base, 0, prefix_size);
+    return compressFast(table, acceleration_, base, prefix_size, src_size, dst, dst_capacity);
+}
+
+void LZ4Compressor::resetTable(size_t span) {
+    if (span > UINT32_MAX - tableEnd_) {
+        std::fill(hashTable, hashTable + HASH_TABLE_SIZE, 0);
+        tableEnd_ = 1;
+    }
+    tableOffset_ = tableEnd_;
+    tableEnd_ += static_cast<uint32_t>(span);
+}
+
+void LZ4Compressor::loadDictionary(const uint8_t* dict, size_t dict_size) {
+    // matches reach back one window at most, keep its last bytes
+    size_t keep = std::min(dict_size, static_cast<size_t>(WINDOW_SIZE));
+    dictBuffer_.assign(dict + dict_size - keep, dict + dict_size);
+    dictSize_ = keep;
+
+    // the dictionary table is the first generation of an empty table
+    std::fill(hashTable, hashTable + HASH_TABLE_SIZE, 0);
+    tableEnd_ = 1;
+    resetTable(dictSize_);
+    PositionTable<uint32_t> table{hashTable, tableOffset_, 32 - HASH_LOG};
+    hashRange(table, dictBuffer_.data(), 0, dictSize_);
+    if (!dictTable_) {
+        dictTable_.reset(new uint32_t[HASH_TABLE_SIZE]);
+    }
+    std::copy(hashTable, hashTable + HASH_TABLE_SIZE, dictTable_.get());
+    tableHoldsDictionary_ = true;
+
+    // HC chains over the same positions, inserted as findBestMatchHC does
+    if (!dictChain_) {
+        dictChain_.reset(new uint16_t[WINDOW_SIZE]());
+    }
+    std::vector<uint32_t> last(HASH_TABLE_SIZE, 0);
+    for (size_t pos = 0; pos + LZ4_MIN_MATCH <= dictSize_; pos++) {
+        uint32_t hash = hashFunction(dictBuffer_.data() + pos);
+        size_t delta = last[hash] == 0 ? 0 : pos + 1 - last[hash];
+        dictChain_[pos % WINDOW_SIZE] = delta > LZ4_MAX_DISTANCE ? 0 : static_cast<uint16_t>(delta);
+        last[hash] = static_cast<uint32_t>(pos + 1);
+    }
+    chainHoldsDictionary_ = false;
+}
+
+size_t LZ4Compressor::compressWithDictionary(const uint8_t* src, size_t src_size,
+                                             uint8_t* dst, size_t dst_capacity) {
+    if (!dictTable_) {
+        return compress(src, src_size, dst, dst_capacity);
+    }
+    if (src_size > LZ4_MAX_INPUT_SIZE - WINDOW_SIZE) {
+        throw std::runtime_error("Input too large");
+    }
+
+    // the input goes right after the dictionary, which is its history
+    dictBuffer_.resize(dictSize_ + src_size);
+    if (src_size > 0) {
+        std::memcpy(dictBuffer_.data() + dictSize_, src, src_size);
+    }
+    const uint8_t* base = dictBuffer_.data();
+
+    if (!tableHoldsDictionary_) {
+        std::copy(dictTable_.get(), dictTable_.get() + HASH_TABLE_SIZE, hashTable);
+        tableEnd_ = 1;
+        resetTable(dictSize_);
+    }
+    // the input's positions go on in the dictionary's generation, and
+    // tableEnd_ stays above them
+    tableEnd_ = std::max<size_t>(tableEnd_, tableOffset_ + dictSize_ + src_size);
+    // until the restore below, in case the codec throws
+    tableHoldsDictionary_ = false;
+
+    // the last positions of the dictionary hash bytes of the input, they
+    // are left out of the primed state and inserted per call
+    size_t primed = dictSize_ >= LZ4_MIN_MATCH - 1 ? dictSize_ - (LZ4_MIN_MATCH - 1) : 0;
+    size_t written;
+    if (mode_ == Mode::HC) {
+        if (!chainHoldsDictionary_) {
+            if (!chainTable_) {
+                chainTable_.reset(new uint16_t[WINDOW_SIZE]);
             }
+            std::copy(dictChain_.get(), dictChain_.get() + WINDOW_SIZE, chainTable_.get());
         }
-        for (int j = globalLastMatchPosition; j < inputSize; ++j) {
-            block.literals.push_back(input[j]);
+        written = compressHC(base, dictSize_, src_size, dst, dst_capacity, primed);
+        // put back the chain entries of the positions inserted
+        for (size_t pos = primed; pos < nextToInsert_; pos++) {
+            chainTable_[pos % WINDOW_SIZE] = dictChain_[pos % WINDOW_SIZE];
         }
-        block.matchOffset = 0;
-        block.encode(output);
+        chainHoldsDictionary_ = true;
+    } else {
+        PositionTable<uint32_t> table{hashTable, tableOffset_, 32 - HASH_LOG};
+        written = compressFast(table, acceleration_, base, dictSize_, src_size, dst, dst_capacity);
     }
 
-    return output;
+    // only entries of hashes seen in the input changed, put back the
+    // dictionary's, which is far cheaper than a full table copy for
+    // small inputs
+    for (size_t pos = primed; pos + LZ4_MIN_MATCH <= dictSize_ + src_size; pos++) {
+        uint32_t hash = hashFunction(base + pos);
+        hashTable[hash] = dictTable_[hash];
+    }
+    tableHoldsDictionary_ = true;
+    return written;
 }
 
-std::vector<char> LZ4Compressor::decompress(const std::vector<char>& input) {
-    printf("start decompress\n");
-    std::vector<char> output;
-
-    // implement the decompression
-    for (int i = 0; i < input.size();) {
-        printf("#### new token i: %d output size: %ld\n", i, output.size());
-        // get the token
-        int token = input[i];
-        // get the literal length
-        int literalLength = token & 0xF;
-        // get the match length
-        int matchLength = ((token >> 4) & 0xF) + 4;
-        printf("literalLength: %d, matchLength: %d\n", literalLength, matchLength);
-        // literal is 15, get following bytes until the byte is less than 255
-        if (literalLength == 15) {
-            int tmpLiteralLength = 0;
-            i++;
-            while (input[i] == 255) {
-                tmpLiteralLength += input[i];
-                i++;
+size_t LZ4Compressor::findBestMatchHC(const uint8_t* base, size_t pos, const uint8_t* limit,
+                                      const uint8_t*& match) {
+    uint16_t* chain = chainTable_.get();
+
+    // every position gets chained, including those inside matches
+    for (; nextToInsert_ <= pos; nextToInsert_++) {
+        uint32_t hash = hashFunction(base + nextToInsert_);
+        uint32_t prev = hashTable[hash];
+        size_t delta = prev < tableOffset_ ? 0 : nextToInsert_ - (prev - tableOffset_);
+        chain[nextToInsert_ % WINDOW_SIZE] = delta > LZ4_MAX_DISTANCE ? 0 : static_cast<uint16_t>(delta);
+        hashTable[hash] = static_cast<uint32_t>(nextToInsert_ + tableOffset_);
+    }
+
+    const uint8_t* ip = base + pos;
+    uint32_t sequence = load32(ip);
+    size_t best = 0;
+    size_t candidate = pos;
+    for (int attempts = max_attempts_; attempts > 0; attempts--) {
+        uint16_t delta = chain[candidate % WINDOW_SIZE];
+        if (delta == 0 || pos - (candidate - delta) > static_cast<size_t>(LZ4_MAX_DISTANCE)) {
+            break;
+        }
+        candidate -= delta;
+
+        const uint8_t* ref = base + candidate;
+        // a longer match must also agree on the byte at the current best
+        if (ref[best] != ip[best] || load32(ref) != sequence) {
+            continue;
+        }
+        size_t length = LZ4_MIN_MATCH + findMatchLength(ip + LZ4_MIN_MATCH, ref + LZ4_MIN_MATCH, limit);
+        if (length > best) {
+            best = length;
+            match = ref;
+            if (ip + best >= limit) {
+                break;
             }
-            tmpLiteralLength += input[i];
-            literalLength += tmpLiteralLength;
-        }
-
-        i++;
-        // copy the literals
-        int endLiteralIndex = i + literalLength;
-        for (; i < endLiteralIndex; ++i) {
-            printf("literals i: %d, input[i]: %d\n", i, input[i]);
-            output.push_back(input[i]);
-        }
-
-        if (matchLength != 0) {
-            int matchOffset = input[i++] | (input[i++] << 8);
-            // match is 19, get following bytes until the byte is less than 255
-            if (matchLength == 19) {
-                int tmpMatchLength = 0;
-                i++;
-                while (input[i] == 255) {
-                    tmpMatchLength += input[i];
-                    i++;
-                }
-                tmpMatchLength += input[i];
-                matchLength += tmpMatchLength;
+        }
+    }
+    return best;
+}
+
+size_t LZ4Compressor::compressHC(const uint8_t* base, size_t start, size_t src_size,
+                                 uint8_t* dst, size_t dst_capacity, size_t chained) {
+    if (!chainTable_) {
+        chainTable_.reset(new uint16_t[WINDOW_SIZE]);
+    }
+    // the rest of the prefix is chained by the first search
+    nextToInsert_ = chained;
+    chainHoldsDictionary_ = false;
+
+    const uint8_t* ip = base + start;
+    const uint8_t* anchor = ip;
+    const uint8_t* const iend = ip + src_size;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dst_capacity;
+
+    if (src_size > static_cast<size_t>(LZ4_MF_LIMIT)) {
+        const uint8_t* const mflimit = iend - LZ4_MF_LIMIT;
+        const uint8_t* const matchlimit = iend - LZ4_LAST_LITERALS;
+
+        while (ip <= mflimit) {
+            const uint8_t* match = nullptr;
+            size_t length = findBestMatchHC(base, ip - base, matchlimit, match);
+            if (length == 0) {
+                ip++;
+                continue;
             }
-            // copy the match characters
-            int startMatchIndex = output.size() - matchOffset;
-            printf("startMatchIndex: %d match offset: %d\n", startMatchIndex, matchOffset);
-            for (int j = 0; j < matchLength; ++j) {
-                output.push_back(output[startMatchIndex + j]);
+
+            // lazy matching: while the next position has a longer match,
+            // emit the current byte as a literal and take that one instead
+            while (ip + 1 <= mflimit) {
+                const uint8_t* next_match = nullptr;
+                size_t next_length = findBestMatchHC(base, ip + 1 - base, matchlimit, next_match);
+                if (next_length <= length) {
+                    break;
+                }
+                ip++;
+                match = next_match;
+                length = next_length;
             }
+
+            op = writeSequence(op, oend, anchor, ip - anchor, ip - match, length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, oend, anchor, iend - anchor, 0, 0);
+    return op - dst;
+}
+
+size_t LZ4Compressor::decompress(const uint8_t* src, size_t src_size,
+                                 uint8_t* dst, size_t dst_capacity) {
+    return decompressWithPrefix(src, src_size, dst, dst_capacity, 0);
+}
+
+namespace {
+
+// Decode one block into dst. The prefix_size bytes before dst are history,
+// and before them the dict_size bytes ending at dict + dict_size.
+size_t decodeBlock(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_capacity,
+                   size_t prefix_size, const uint8_t* dict, size_t dict_size) {
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + src_size;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dst_capacity;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length += readLength(ip, iend);
+        }
+        if (static_cast<size_t>(iend - ip) < literal_length) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        if (static_cast<size_t>(oend - op) < literal_length) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        if (static_cast<size_t>(iend - ip) >= literal_length + WILD_COPY_SLACK &&
+            static_cast<size_t>(oend - op) >= literal_length + WILD_COPY_SLACK) {
+            // 16 bytes at a time, overrunning into the slack
+            wildCopy16(op, ip, op + literal_length);
+        } else if (literal_length > 0) {
+            std::memcpy(op, ip, literal_length);
+        }
+        ip += literal_length;
+        op += literal_length;
+
+        // the last sequence has literals only
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t history = static_cast<size_t>(op - dst) + prefix_size;
+        if (offset == 0 || offset > history + dict_size) {
+            throw std::runtime_error("Invalid match offset");
+        }
+
+        size_t match_length = (token & 0xF) + LZ4_MIN_MATCH;
+        if ((token & 0xF) == 15) {
+            match_length += readLength(ip, iend);
+        }
+        if (static_cast<size_t>(oend - op) < match_length) {
+            throw std::runtime_error("Output buffer too small");
+        }
+
+        // the part of the match in the external dictionary
+        if (offset > history) {
+            size_t from_dict = std::min(offset - history, match_length);
+            std::memcpy(op, dict + dict_size - (offset - history), from_dict);
+            op += from_dict;
+            match_length -= from_dict;
+        }
+        // wide copies always move at least one step
+        if (match_length > 0) {
+            copyMatch(op, offset, match_length, oend);
+            op += match_length;
+        }
+    }
+
+    return op - dst;
+}
+
+} // namespace
+
+size_t LZ4Compressor::decompressWithPrefix(const uint8_t* src, size_t src_size,
+                                           uint8_t* dst, size_t dst_capacity,
+                                           size_t prefix_size) {
+    return decodeBlock(src, src_size, dst, dst_capacity, prefix_size, nullptr, 0);
+}
+
+size_t LZ4Compressor::decompressWithDictionary(const uint8_t* src, size_t src_size,
+                                               uint8_t* dst, size_t dst_capacity,
+                                               const uint8_t* dict, size_t dict_size) {
+    // the compressor only used the last window of the dictionary
+    if (dict_size > static_cast<size_t>(WINDOW_SIZE)) {
+        dict += dict_size - WINDOW_SIZE;
+        dict_size = WINDOW_SIZE;
+    }
+    return decodeBlock(src, src_size, dst, dst_capacity, 0, dict, dict_size);
+}
+
+
+size_t LZ4Compressor::decompressedSize(const uint8_t* src, size_t src_size) {
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + src_size;
+    size_t size = 0;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length += readLength(ip, iend);
+        }
+        if (static_cast<size_t>(iend - ip) < literal_length) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        ip += literal_length;
+        size += literal_length;
+        if (ip == iend) {
+            break;
         }
+
+        if (iend - ip < 2) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+        ip += 2;
+        size_t match_length = (token & 0xF) + LZ4_MIN_MATCH;
+        if ((token & 0xF) == 15) {
+            match_length += readLength(ip, iend);
+        }
+        size += match_length;
     }
+
+    return size;
+}
+
+std::vector<char> LZ4Compressor::compress(const std::vector<char>& input) {
+    std::vector<char> output(compressBound(input.size()));
+    output.resize(compress(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                           reinterpret_cast<uint8_t*>(output.data()), output.size()));
+    return output;
+}
+
+std::vector<char> LZ4Compressor::decompress(const std::vector<char>& input) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(input.data());
+    std::vector<char> output(decompressedSize(src, input.size()));
+    output.resize(decompress(src, input.size(),
+                             reinterpret_cast<uint8_t*>(output.data()), output.size()));
     return output;
 }
 
+namespace compression {
+
+size_t LZ4Codec::compress(const uint8_t* src, size_t src_size,
+                          uint8_t* dst, size_t dst_capacity) {
+    return lz4_.compress(src, src_size, dst, dst_capacity);
+}
+
+size_t LZ4Codec::decompress(const uint8_t* src, size_t src_size,
+                            uint8_t* dst, size_t dst_capacity) {
+    return lz4_.decompress(src, src_size, dst, dst_capacity);
+}
 
+} // namespace compression
@@ -0,0 +1,118 @@
+// src/lz4_dict.cc
+#include "compression/lz4.h"
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+// substrings are scored by how many samples contain their 8-byte grams
+constexpr size_t GRAM_SIZE = 8;
+// dictionary pieces, taken from the samples at SEGMENT_STEP offsets
+constexpr size_t SEGMENT_SIZE = 64;
+constexpr size_t SEGMENT_STEP = 16;
+
+struct Segment {
+    size_t sample;
+    size_t offset;
+    size_t size;
+};
+
+uint64_t loadGram(const uint8_t* p) {
+    uint64_t gram;
+    std::memcpy(&gram, p, GRAM_SIZE);
+    return gram;
+}
+
+} // namespace
+
+std::vector<uint8_t> LZ4Compressor::trainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                                    size_t dict_size) {
+    dict_size = std::min(dict_size, static_cast<size_t>(WINDOW_SIZE));
+
+    // number of samples each gram occurs in
+    struct GramStat {
+        uint32_t samples = 0;
+        uint32_t last = UINT32_MAX;
+    };
+    std::unordered_map<uint64_t, GramStat> grams;
+    for (size_t s = 0; s < samples.size(); s++) {
+        const std::vector<uint8_t>& sample = samples[s];
+        for (size_t i = 0; i + GRAM_SIZE <= sample.size(); i++) {
+            GramStat& stat = grams[loadGram(sample.data() + i)];
+            if (stat.last != s) {
+                stat.last = static_cast<uint32_t>(s);
+                stat.samples++;
+            }
+        }
+    }
+
+    std::vector<Segment> segments;
+    for (size_t s = 0; s < samples.size(); s++) {
+        size_t size = samples[s].size();
+        for (size_t offset = 0; offset < size; offset += SEGMENT_STEP) {
+            segments.push_back({s, offset, std::min(SEGMENT_SIZE, size - offset)});
+            if (offset + SEGMENT_SIZE >= size) {
+                break;
+            }
+        }
+    }
+
+    // grams that only one sample has are no use to the others; grams
+    // already in the dictionary count for nothing
+    auto score = [&](const Segment& segment) {
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        uint64_t total = 0;
+        for (size_t i = 0; i + GRAM_SIZE <= segment.size; i++) {
+            auto it = grams.find(loadGram(data + i));
+            if (it->second.samples > 1) {
+                total += it->second.samples;
+            }
+        }
+        return total;
+    };
+
+    // greedy selection with lazy rescoring, scores only drop as segments
+    // are taken, so a rescored top entry that still beats the next is best
+    std::priority_queue<std::pair<uint64_t, size_t>> queue;
+    for (size_t i = 0; i < segments.size(); i++) {
+        if (uint64_t value = score(segments[i])) {
+            queue.push({value, i});
+        }
+    }
+
+    std::vector<size_t> picked;
+    size_t total_size = 0;
+    while (!queue.empty() && total_size < dict_size) {
+        size_t index = queue.top().second;
+        queue.pop();
+        uint64_t value = score(segments[index]);
+        if (value == 0) {
+            continue;
+        }
+        if (!queue.empty() && value < queue.top().first) {
+            queue.push({value, index});
+            continue;
+        }
+
+        const Segment& segment = segments[index];
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        for (size_t i = 0; i + GRAM_SIZE <= segment.size; i++) {
+            grams[loadGram(data + i)].samples = 0;
+        }
+        picked.push_back(index);
+        total_size += segment.size;
+    }
+
+    // the best segments go last, closest to the input, for short offsets
+    // and so they survive when a longer dictionary is cut to the window
+    std::vector<uint8_t> dict;
+    for (auto it = picked.rbegin(); it != picked.rend(); ++it) {
+        const Segment& segment = segments[*it];
+        const uint8_t* data = samples[segment.sample].data() + segment.offset;
+        dict.insert(dict.end(), data, data + segment.size);
+    }
+    if (dict.size() > dict_size) {
+        dict.erase(dict.begin(), dict.begin() + (dict.size() - dict_size));
+    }
+    return dict;
+}
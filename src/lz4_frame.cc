@@ -0,0 +1,313 @@
+// src/lz4_frame.cc
+#include "compression/lz4_frame.h"
+#include "compression/xxhash.h"
+#include "compression/common.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace compression {
+
+namespace {
+
+// FLG bits
+constexpr uint8_t FLG_VERSION = 0x40;
+constexpr uint8_t FLG_VERSION_MASK = 0xC0;
+constexpr uint8_t FLG_BLOCK_INDEPENDENCE = 0x20;
+constexpr uint8_t FLG_BLOCK_CHECKSUM = 0x10;
+constexpr uint8_t FLG_CONTENT_SIZE = 0x08;
+constexpr uint8_t FLG_CONTENT_CHECKSUM = 0x04;
+constexpr uint8_t FLG_RESERVED = 0x02;
+constexpr uint8_t FLG_DICT_ID = 0x01;
+
+// header checksum over the frame descriptor, FLG up to the checksum byte
+uint8_t headerChecksum(const uint8_t* descriptor, size_t size) {
+    return (xxhash32(descriptor, size) >> 8) & 0xFF;
+}
+
+} // namespace
+
+size_t LZ4Frame::maxCompressedSize(size_t src_size) const {
+    // blocks that do not shrink are stored, so each costs its size word
+    // and checksum on top of the raw bytes
+    size_t block_max = blockMaxSize(block_size_);
+    size_t num_blocks = (src_size + block_max - 1) / block_max;
+    return 7 + (content_size_ ? 8 : 0) +
+           num_blocks * (4 + (block_checksum_ ? 4 : 0)) + src_size +
+           4 + (content_checksum_ ? 4 : 0);
+}
+
+size_t LZ4Frame::compress(const uint8_t* src, size_t src_size,
+                          uint8_t* dst, size_t dst_capacity) {
+    size_t header_size = 7 + (content_size_ ? 8 : 0);
+    if (dst_capacity < header_size) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dst_capacity;
+
+    storeValue<uint32_t>(op, MAGIC);
+    op[4] = FLG_VERSION |
+            (independent_ ? FLG_BLOCK_INDEPENDENCE : 0) |
+            (block_checksum_ ? FLG_BLOCK_CHECKSUM : 0) |
+            (content_size_ ? FLG_CONTENT_SIZE : 0) |
+            (content_checksum_ ? FLG_CONTENT_CHECKSUM : 0);
+    op[5] = static_cast<uint8_t>(static_cast<int>(block_size_) << 4);
+    if (content_size_) {
+        storeValue<uint64_t>(op + 6, src_size);
+    }
+    op[header_size - 1] = headerChecksum(op + 4, header_size - 5);
+    op += header_size;
+
+    size_t block_max = blockMaxSize(block_size_);
+    std::vector<uint8_t> scratch;
+
+    for (size_t offset = 0; offset < src_size; offset += block_max) {
+        size_t size = std::min(block_max, src_size - offset);
+        // linked blocks see the window before them
+        size_t prefix = independent_ ? 0 : offset;
+
+        if (oend - op < 4) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        uint8_t* data = op + 4;
+        size_t room = oend - data;
+
+        size_t written;
+        if (room >= LZ4Compressor::compressBound(size)) {
+            written = lz4_.compressWithPrefix(src + offset, size, data, room, prefix);
+        } else {
+            scratch.resize(LZ4Compressor::compressBound(size));
+            written = lz4_.compressWithPrefix(src + offset, size, scratch.data(),
+                                              scratch.size(), prefix);
+            if (written < size) {
+                if (room < written) {
+                    throw std::runtime_error("Output buffer too small");
+                }
+                std::memcpy(data, scratch.data(), written);
+            }
+        }
+
+        uint32_t entry = static_cast<uint32_t>(written);
+        if (written >= size) {
+            if (room < size) {
+                throw std::runtime_error("Output buffer too small");
+            }
+            std::memcpy(data, src + offset, size);
+            written = size;
+            entry = static_cast<uint32_t>(size) | STORED_BLOCK;
+        }
+        storeValue<uint32_t>(op, entry);
+        op = data + written;
+
+        if (block_checksum_) {
+            if (oend - op < 4) {
+                throw std::runtime_error("Output buffer too small");
+            }
+            storeValue<uint32_t>(op, xxhash32(data, written));
+            op += 4;
+        }
+    }
+
+    size_t trailer = 4 + (content_checksum_ ? 4 : 0);
+    if (static_cast<size_t>(oend - op) < trailer) {
+        throw std::runtime_error("Output buffer too small");
+    }
+    storeValue<uint32_t>(op, 0);
+    op += 4;
+    if (content_checksum_) {
+        storeValue<uint32_t>(op, xxhash32(src, src_size));
+        op += 4;
+    }
+
+    return op - dst;
+}
+
+LZ4Frame::Header LZ4Frame::readHeader(const uint8_t* src, size_t src_size) const {
+    if (src_size < 7 || loadValue<uint32_t>(src) != MAGIC) {
+        throw std::runtime_error("Invalid LZ4 frame");
+    }
+
+    uint8_t flg = src[4];
+    uint8_t bd = src[5];
+    if ((flg & FLG_VERSION_MASK) != FLG_VERSION || (flg & FLG_RESERVED) ||
+        (bd & 0x8F) || ((bd >> 4) & 0x7) < 4) {
+        throw std::runtime_error("Invalid LZ4 frame");
+    }
+    if (flg & FLG_DICT_ID) {
+        throw std::runtime_error("LZ4 frame dictionaries are not supported");
+    }
+
+    Header header;
+    header.independent = flg & FLG_BLOCK_INDEPENDENCE;
+    header.block_checksum = flg & FLG_BLOCK_CHECKSUM;
+    header.content_checksum = flg & FLG_CONTENT_CHECKSUM;
+    header.has_content_size = flg & FLG_CONTENT_SIZE;
+    header.block_max_size = blockMaxSize(static_cast<BlockSize>((bd >> 4) & 0x7));
+    header.size = 7 + (header.has_content_size ? 8 : 0);
+    header.content_size = 0;
+
+    if (src_size < header.size) {
+        throw std::runtime_error("Invalid LZ4 frame");
+    }
+    if (header.has_content_size) {
+        header.content_size = loadValue<uint64_t>(src + 6);
+    }
+    if (src[header.size - 1] != headerChecksum(src + 4, header.size - 5)) {
+        throw std::runtime_error("LZ4 frame header checksum mismatch");
+    }
+    return header;
+}
+
+std::vector<LZ4Frame::BlockInfo> LZ4Frame::blockIndex(const uint8_t* src, size_t src_size) const {
+    Header header = readHeader(src, src_size);
+    std::vector<BlockInfo> blocks;
+    size_t pos = header.size;
+    size_t decompressed = 0;
+
+    while (true) {
+        if (src_size - pos < 4) {
+            throw std::runtime_error("Invalid LZ4 frame");
+        }
+        uint32_t entry = loadValue<uint32_t>(src + pos);
+        pos += 4;
+        if (entry == 0) {
+            break;
+        }
+
+        BlockInfo block;
+        block.offset = pos;
+        block.size = entry & ~STORED_BLOCK;
+        block.stored = entry & STORED_BLOCK;
+        size_t checksum_size = header.block_checksum ? 4 : 0;
+        if (block.size > header.block_max_size || src_size - pos < block.size + checksum_size) {
+            throw std::runtime_error("Invalid LZ4 frame");
+        }
+        if (header.block_checksum &&
+            loadValue<uint32_t>(src + pos + block.size) != xxhash32(src + pos, block.size)) {
+            throw std::runtime_error("LZ4 block checksum mismatch");
+        }
+
+        block.decompressed_offset = decompressed;
+        block.decompressed_size = block.stored
+            ? block.size
+            : LZ4Compressor::decompressedSize(src + pos, block.size);
+        if (block.decompressed_size > header.block_max_size) {
+            throw std::runtime_error("Invalid LZ4 frame");
+        }
+        decompressed += block.decompressed_size;
+        blocks.push_back(block);
+        pos += block.size + checksum_size;
+    }
+
+    if (src_size - pos != (header.content_checksum ? 4u : 0u)) {
+        throw std::runtime_error("Invalid LZ4 frame");
+    }
+    return blocks;
+}
+
+size_t LZ4Frame::decompressBlock(const uint8_t* src, size_t src_size, const BlockInfo& block,
+                                 uint8_t* dst, size_t dst_capacity) const {
+    if (!readHeader(src, src_size).independent) {
+        throw std::runtime_error("LZ4 frame blocks are linked");
+    }
+    if (block.offset > src_size || src_size - block.offset < block.size) {
+        throw std::runtime_error("Invalid LZ4 frame");
+    }
+    if (block.stored) {
+        if (dst_capacity < block.size) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        std::memcpy(dst, src + block.offset, block.size);
+        return block.size;
+    }
+    return LZ4Compressor::decompress(src + block.offset, block.size, dst, dst_capacity);
+}
+
+size_t LZ4Frame::decompressedSize(const uint8_t* src, size_t src_size) const {
+    Header header = readHeader(src, src_size);
+    if (header.has_content_size) {
+        return header.content_size;
+    }
+    size_t size = 0;
+    for (const BlockInfo& block : blockIndex(src, src_size)) {
+        size += block.decompressed_size;
+    }
+    return size;
+}
+
+size_t LZ4Frame::decompress(const uint8_t* src, size_t src_size,
+                            uint8_t* dst, size_t dst_capacity) {
+    Header header = readHeader(src, src_size);
+    size_t written = 0;
+    size_t pos;
+
+    if (pool_ && header.independent) {
+        // the index gives every block's place, decode them side by side
+        std::vector<BlockInfo> blocks = blockIndex(src, src_size);
+        for (const BlockInfo& block : blocks) {
+            written += block.decompressed_size;
+        }
+        if (written > dst_capacity) {
+            throw std::runtime_error("Output buffer too small");
+        }
+        pool_->parallelFor(blocks.size(), [&](size_t i) {
+            const BlockInfo& block = blocks[i];
+            if (decompressBlock(src, src_size, block, dst + block.decompressed_offset,
+                                block.decompressed_size) != block.decompressed_size) {
+                throw std::runtime_error("Invalid LZ4 frame");
+            }
+        });
+        pos = src_size - (header.content_checksum ? 4 : 0);
+    } else {
+        pos = header.size;
+        size_t checksum_size = header.block_checksum ? 4 : 0;
+        while (true) {
+            if (src_size - pos < 4) {
+                throw std::runtime_error("Invalid LZ4 frame");
+            }
+            uint32_t entry = loadValue<uint32_t>(src + pos);
+            pos += 4;
+            if (entry == 0) {
+                break;
+            }
+
+            size_t size = entry & ~STORED_BLOCK;
+            if (size > header.block_max_size || src_size - pos < size + checksum_size) {
+                throw std::runtime_error("Invalid LZ4 frame");
+            }
+            const uint8_t* data = src + pos;
+            if (header.block_checksum &&
+                loadValue<uint32_t>(data + size) != xxhash32(data, size)) {
+                throw std::runtime_error("LZ4 block checksum mismatch");
+            }
+
+            size_t room = std::min(header.block_max_size, dst_capacity - written);
+            if (entry & STORED_BLOCK) {
+                if (room < size) {
+                    throw std::runtime_error("Output buffer too small");
+                }
+                std::memcpy(dst + written, data, size);
+                written += size;
+            } else {
+                // linked blocks may match into everything decoded so far
+                written += LZ4Compressor::decompressWithPrefix(
+                    data, size, dst + written, room, header.independent ? 0 : written);
+            }
+            pos += size + checksum_size;
+        }
+    }
+
+    if (header.has_content_size && written != header.content_size) {
+        throw std::runtime_error("LZ4 frame content size mismatch");
+    }
+    if (header.content_checksum) {
+        if (src_size - pos < 4 || loadValue<uint32_t>(src + pos) != xxhash32(dst, written)) {
+            throw std::runtime_error("LZ4 frame content checksum mismatch");
+        }
+    }
+    return written;
+}
+
+} // namespace compression
@@ -0,0 +1,157 @@
+// src/page_store.cc
+#include "compression/page_store.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace compression {
+
+PageStore::PageStore(CodecFactory factory, size_t num_pages, size_t num_threads)
+    : pages_(num_pages) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (num_threads > 1) {
+        pool_ = std::make_unique<ThreadPool>(num_threads);
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        codecs_.push_back(factory());
+        scratch_.emplace_back(LINES_PER_PAGE * codecs_.back()->maxCompressedSize(LINE_SIZE));
+    }
+}
+
+const PageStore::Page& PageStore::at(size_t page) const {
+    if (page >= pages_.size()) {
+        throw std::runtime_error("Page out of range");
+    }
+    return pages_[page];
+}
+
+void PageStore::encodePage(CompressionBase& codec, std::vector<uint8_t>& scratch,
+                           const uint8_t* src, Page& page) {
+    // the page is left as it was if the codec throws
+    CompressionBase::LineRecord records[LINES_PER_PAGE];
+    codec.compressLines(src, LINES_PER_PAGE, scratch.data(), scratch.size(), records);
+    std::copy(records, records + LINES_PER_PAGE, page.records);
+
+    // lines that did not shrink are copied from src instead
+    uint64_t raw_lines = 0;
+    size_t size = 0;
+    for (size_t i = 0; i < LINES_PER_PAGE; i++) {
+        page.offsets[i] = static_cast<uint16_t>(size);
+        if (records[i].size >= LINE_SIZE) {
+            raw_lines |= uint64_t(1) << i;
+            size += LINE_SIZE;
+        } else {
+            size += records[i].size;
+        }
+    }
+    page.offsets[LINES_PER_PAGE] = static_cast<uint16_t>(size);
+
+    if (raw_lines == 0) {
+        page.payload.assign(scratch.data(), scratch.data() + size);
+    } else {
+        page.payload.resize(size);
+        const uint8_t* coded = scratch.data();
+        for (size_t i = 0; i < LINES_PER_PAGE; i++) {
+            uint8_t* dst = page.payload.data() + page.offsets[i];
+            if (raw_lines >> i & 1) {
+                std::memcpy(dst, src + i * LINE_SIZE, LINE_SIZE);
+            } else {
+                std::memcpy(dst, coded, records[i].size);
+            }
+            coded += records[i].size;
+        }
+    }
+    page.raw_lines = raw_lines;
+    page.written = true;
+}
+
+void PageStore::writePage(size_t page, const uint8_t* src) {
+    writePages(page, src, 1);
+}
+
+void PageStore::writePages(size_t first_page, const uint8_t* src, size_t num_pages) {
+    if (first_page > pages_.size() || num_pages > pages_.size() - first_page) {
+        throw std::runtime_error("Page out of range");
+    }
+
+    // stripe s takes every stripes-th page with its own codec and scratch,
+    // and sums the size change of its pages in growth[s]
+    size_t stripes = std::min(codecs_.size(), num_pages);
+    std::vector<size_t> growth(stripes, 0);
+    auto stripe = [&](size_t s) {
+        for (size_t i = s; i < num_pages; i += stripes) {
+            Page& page = pages_[first_page + i];
+            size_t old_size = page.payload.size();
+            encodePage(*codecs_[s], scratch_[s], src + i * PAGE_SIZE, page);
+            growth[s] += page.payload.size() - old_size;
+        }
+    };
+
+    // pages written before a failure stay written and counted
+    try {
+        if (stripes == 1) {
+            stripe(0);
+        } else {
+            pool_->parallelFor(stripes, stripe);
+        }
+    } catch (...) {
+        for (size_t g : growth) {
+            total_size_ += g;
+        }
+        throw;
+    }
+    for (size_t g : growth) {
+        total_size_ += g;
+    }
+}
+
+void PageStore::readLine(size_t page, size_t line, uint8_t* dst) {
+    const Page& p = at(page);
+    if (line >= LINES_PER_PAGE) {
+        throw std::runtime_error("Line out of range");
+    }
+    if (!p.written) {
+        std::memset(dst, 0, LINE_SIZE);
+        return;
+    }
+
+    const uint8_t* src = p.payload.data() + p.offsets[line];
+    if (p.raw_lines >> line & 1) {
+        std::memcpy(dst, src, LINE_SIZE);
+    } else {
+        codecs_[0]->decompressLines(src, p.records[line].size, &p.records[line], 1, dst);
+    }
+}
+
+void PageStore::readPage(size_t page, uint8_t* dst) {
+    const Page& p = at(page);
+    if (!p.written) {
+        std::memset(dst, 0, PAGE_SIZE);
+        return;
+    }
+    if (p.raw_lines == 0) {
+        codecs_[0]->decompressLines(p.payload.data(), p.payload.size(), p.records,
+                                    LINES_PER_PAGE, dst);
+        return;
+    }
+    for (size_t i = 0; i < LINES_PER_PAGE; i++) {
+        readLine(page, i, dst + i * LINE_SIZE);
+    }
+}
+
+size_t PageStore::compressedSize(size_t page) const {
+    return at(page).payload.size();
+}
+
+size_t PageStore::lineCompressedSize(size_t page, size_t line) const {
+    const Page& p = at(page);
+    if (line >= LINES_PER_PAGE) {
+        throw std::runtime_error("Line out of range");
+    }
+    return p.offsets[line + 1] - p.offsets[line];
+}
+
+} // namespace compression
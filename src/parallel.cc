@@ -0,0 +1,169 @@
+// src/parallel.cc
+#include "compression/parallel.h"
+#include "compression/common.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace compression {
+
+ParallelCompressor::ParallelCompressor(CodecFactory factory, size_t chunk_size,
+                                       size_t num_threads)
+    : factory_(std::move(factory)),
+      bound_codec_(factory_()),
+      chunk_size_(chunk_size),
+      pool_(num_threads) {
+    if (chunk_size_ == 0 || chunk_size_ >= STORED_CHUNK) {
+        throw std::runtime_error("Invalid chunk size");
+    }
+}
+
+size_t ParallelCompressor::chunkBound(size_t size) const {
+    return std::max(bound_codec_->maxCompressedSize(size), size);
+}
+
+size_t ParallelCompressor::maxCompressedSize(size_t src_size) const {
+    size_t full = src_size / chunk_size_;
+    size_t tail = src_size % chunk_size_;
+    size_t num_chunks = full + (tail ? 1 : 0);
+
+    return HEADER_SIZE + num_chunks * 4 + full * chunkBound(chunk_size_) +
+           (tail ? chunkBound(tail) : 0);
+}
+
+std::unique_ptr<CompressionBase> ParallelCompressor::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(codecs_mutex_);
+        if (!codecs_.empty()) {
+            std::unique_ptr<CompressionBase> codec = std::move(codecs_.back());
+            codecs_.pop_back();
+            return codec;
+        }
+    }
+    return factory_();
+}
+
+void ParallelCompressor::release(std::unique_ptr<CompressionBase> codec) {
+    std::lock_guard<std::mutex> lock(codecs_mutex_);
+    codecs_.push_back(std::move(codec));
+}
+
+size_t ParallelCompressor::compress(const uint8_t* src, size_t src_size,
+                                    uint8_t* dst, size_t dst_capacity) {
+    if (dst_capacity < maxCompressedSize(src_size)) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    size_t num_chunks = (src_size + chunk_size_ - 1) / chunk_size_;
+    uint8_t* index = dst + HEADER_SIZE;
+    uint8_t* payload = index + num_chunks * 4;
+    size_t slot_size = chunkBound(chunk_size_);
+
+    storeValue<uint32_t>(dst, MAGIC);
+    storeValue<uint32_t>(dst + 4, static_cast<uint32_t>(chunk_size_));
+    storeValue<uint64_t>(dst + 8, src_size);
+
+    // every chunk gets a worst case slot, so the chunks are independent
+    pool_.parallelFor(num_chunks, [&](size_t i) {
+        size_t offset = i * chunk_size_;
+        size_t size = std::min(chunk_size_, src_size - offset);
+        uint8_t* slot = payload + i * slot_size;
+
+        std::unique_ptr<CompressionBase> codec = acquire();
+        size_t written;
+        try {
+            written = codec->compress(src + offset, size, slot, chunkBound(size));
+        } catch (...) {
+            release(std::move(codec));
+            throw;
+        }
+        release(std::move(codec));
+
+        uint32_t entry = static_cast<uint32_t>(written);
+        if (written >= size) {
+            std::memcpy(slot, src + offset, size);
+            entry = static_cast<uint32_t>(size) | STORED_CHUNK;
+        }
+        storeValue<uint32_t>(index + i * 4, entry);
+    });
+
+    // pack the slots, chunks only move towards the front
+    size_t written = 0;
+    for (size_t i = 0; i < num_chunks; i++) {
+        size_t size = loadValue<uint32_t>(index + i * 4) & ~STORED_CHUNK;
+        if (written != i * slot_size) {
+            std::memmove(payload + written, payload + i * slot_size, size);
+        }
+        written += size;
+    }
+
+    return HEADER_SIZE + num_chunks * 4 + written;
+}
+
+size_t ParallelCompressor::decompressedSize(const uint8_t* src, size_t src_size) const {
+    if (src_size < HEADER_SIZE || loadValue<uint32_t>(src) != MAGIC) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    return loadValue<uint64_t>(src + 8);
+}
+
+size_t ParallelCompressor::decompress(const uint8_t* src, size_t src_size,
+                                      uint8_t* dst, size_t dst_capacity) {
+    size_t original_size = decompressedSize(src, src_size);
+    size_t chunk_size = loadValue<uint32_t>(src + 4);
+    if (chunk_size == 0) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    if (original_size > dst_capacity) {
+        throw std::runtime_error("Output buffer too small");
+    }
+
+    size_t num_chunks = (original_size + chunk_size - 1) / chunk_size;
+    if ((src_size - HEADER_SIZE) / 4 < num_chunks) {
+        throw std::runtime_error("Invalid compressed data");
+    }
+    const uint8_t* index = src + HEADER_SIZE;
+    size_t payload = HEADER_SIZE + num_chunks * 4;
+
+    // chunk offsets from the index
+    std::vector<size_t> offsets(num_chunks + 1);
+    offsets[0] = payload;
+    for (size_t i = 0; i < num_chunks; i++) {
+        offsets[i + 1] = offsets[i] + (loadValue<uint32_t>(index + i * 4) & ~STORED_CHUNK);
+        if (offsets[i + 1] > src_size) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+    }
+
+    pool_.parallelFor(num_chunks, [&](size_t i) {
+        size_t offset = i * chunk_size;
+        size_t size = std::min(chunk_size, original_size - offset);
+        uint32_t entry = loadValue<uint32_t>(index + i * 4);
+        size_t comp_size = offsets[i + 1] - offsets[i];
+
+        if (entry & STORED_CHUNK) {
+            if (comp_size != size) {
+                throw std::runtime_error("Invalid compressed data");
+            }
+            std::memcpy(dst + offset, src + offsets[i], size);
+            return;
+        }
+
+        std::unique_ptr<CompressionBase> codec = acquire();
+        size_t written;
+        try {
+            written = codec->decompress(src + offsets[i], comp_size, dst + offset, size);
+        } catch (...) {
+            release(std::move(codec));
+            throw;
+        }
+        release(std::move(codec));
+        if (written != size) {
+            throw std::runtime_error("Invalid compressed data");
+        }
+    });
+
+    return original_size;
+}
+
+} // namespace compression
@@ -0,0 +1,152 @@
+// src/thread_pool.cc
+#include "compression/thread_pool.h"
+#include <algorithm>
+#include <exception>
+
+namespace compression {
+
+namespace {
+
+// pool and queue index of the running worker thread
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::push(Task task) {
+    size_t index = current_pool == this
+        ? current_index
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+    // count the task before it becomes visible so pending_ never underflows
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::pop(size_t self, Task& task) {
+    size_t n = queues_.size();
+
+    if (self < n) {
+        Queue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // steal the oldest task of another queue
+    for (size_t i = 1; i <= n; i++) {
+        Queue& victim = *queues_[(self + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            pending_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    Task task;
+    while (true) {
+        if (pop(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stop_ || pending_.load(std::memory_order_relaxed) > 0;
+        });
+        if (stop_ && pending_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    // tasks of this call left to finish, the last one wakes the caller
+    struct Batch {
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t remaining;
+        std::exception_ptr error;
+    } batch;
+    batch.remaining = count;
+
+    for (size_t i = 0; i < count; i++) {
+        push([&, i] {
+            std::exception_ptr error;
+            try {
+                fn(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            // notify under the lock, batch lives on the caller's stack
+            std::lock_guard<std::mutex> lock(batch.mutex);
+            if (error && !batch.error) {
+                batch.error = error;
+            }
+            if (--batch.remaining == 0) {
+                batch.done.notify_all();
+            }
+        });
+    }
+
+    // help out while there is queued work, this also keeps nested calls
+    // from a worker making progress. With the queues empty the rest of the
+    // batch is running on other threads, so block until it is done.
+    size_t self = current_pool == this ? current_index : queues_.size();
+    Task task;
+    while (pop(self, task)) {
+        task();
+        task = nullptr;
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&] { return batch.remaining == 0; });
+
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+} // namespace compression
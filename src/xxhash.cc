@@ -0,0 +1,66 @@
+// src/xxhash.cc
+#include "compression/xxhash.h"
+#include "compression/common.h"
+
+namespace compression {
+
+namespace {
+
+constexpr uint32_t PRIME1 = 2654435761u;
+constexpr uint32_t PRIME2 = 2246822519u;
+constexpr uint32_t PRIME3 = 3266489917u;
+constexpr uint32_t PRIME4 = 668265263u;
+constexpr uint32_t PRIME5 = 374761393u;
+
+inline uint32_t rotl(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+inline uint32_t round(uint32_t acc, uint32_t input) {
+    return rotl(acc + input * PRIME2, 13) * PRIME1;
+}
+
+} // namespace
+
+uint32_t xxhash32(const uint8_t* data, size_t size, uint32_t seed) {
+    const uint8_t* p = data;
+    const uint8_t* const end = data + size;
+    uint32_t h;
+
+    if (size >= 16) {
+        // four independent lanes over 16-byte stripes
+        uint32_t v1 = seed + PRIME1 + PRIME2;
+        uint32_t v2 = seed + PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - PRIME1;
+        const uint8_t* const limit = end - 16;
+        do {
+            v1 = round(v1, loadValue<uint32_t>(p));
+            v2 = round(v2, loadValue<uint32_t>(p + 4));
+            v3 = round(v3, loadValue<uint32_t>(p + 8));
+            v4 = round(v4, loadValue<uint32_t>(p + 12));
+            p += 16;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    } else {
+        h = seed + PRIME5;
+    }
+
+    h += static_cast<uint32_t>(size);
+
+    for (; p + 4 <= end; p += 4) {
+        h = rotl(h + loadValue<uint32_t>(p) * PRIME3, 17) * PRIME4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h + *p * PRIME5, 11) * PRIME1;
+    }
+
+    h ^= h >> 15;
+    h *= PRIME2;
+    h ^= h >> 13;
+    h *= PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+} // namespace compression
@@ -0,0 +1,172 @@
+#include "compression/adaptive.h"
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+// a page of lines that suit different codecs
+std::vector<uint8_t> makeMixedPage(size_t num_lines, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> page(num_lines * 64);
+    for (size_t line = 0; line < num_lines; line++) {
+        uint8_t* p = page.data() + line * 64;
+        switch (gen() % 6) {
+            case 0:
+                // zeros
+                break;
+            case 1: {
+                // pointers into one region: BDI
+                uint64_t base = 0x00007f3a12400000 + (gen() % 4096) * 64;
+                for (int i = 0; i < 8; i++) {
+                    uint64_t value = base + (gen() % 32) * 8;
+                    std::memcpy(p + i * 8, &value, 8);
+                }
+                break;
+            }
+            case 2: {
+                // 16-bit values and -1 fill: FPC
+                for (int i = 0; i < 16; i++) {
+                    uint32_t value = gen() % 4 ? 256 + gen() % 65000 : 0xFFFFFFFF;
+                    std::memcpy(p + i * 4, &value, 4);
+                }
+                break;
+            }
+            case 3: {
+                // a few words with shared upper bytes: CPack
+                uint32_t words[3] = {static_cast<uint32_t>(gen()), static_cast<uint32_t>(gen()),
+                                     static_cast<uint32_t>(gen())};
+                for (int i = 0; i < 16; i++) {
+                    uint32_t value = words[gen() % 3] ^ (gen() % 4 == 0 ? gen() % 256 : 0);
+                    std::memcpy(p + i * 4, &value, 4);
+                }
+                break;
+            }
+            case 4:
+                // text
+                for (int i = 0; i < 64; i++) {
+                    p[i] = "the quick brown fox "[gen() % 20];
+                }
+                break;
+            default:
+                for (int i = 0; i < 64; i++) {
+                    p[i] = static_cast<uint8_t>(gen());
+                }
+                break;
+        }
+    }
+    return page;
+}
+
+void testRoundTrip() {
+    compression::Adaptive adaptive;
+    std::vector<uint8_t> page = makeMixedPage(1000, 1);
+    page.resize(page.size() + 37, 0x11);
+
+    std::vector<uint8_t> compressed = adaptive.compress(page);
+    assert(compressed.size() <= adaptive.maxCompressedSize(page.size()));
+    assert(adaptive.decompressedSize(compressed.data(), compressed.size()) == page.size());
+    compression::Adaptive other;
+    assert(other.decompress(compressed) == page);
+
+    // every selector is used on a mixed page
+    const uint64_t* counts = adaptive.selectorCounts();
+    for (int s = 0; s < 4; s++) {
+        assert(counts[s] > 0);
+    }
+    assert(counts[0] + counts[1] + counts[2] + counts[3] == 1000);
+
+    // and best-of beats every single codec
+    compression::BDI bdi;
+    compression::FPC fpc;
+    compression::CPack cpack;
+    assert(compressed.size() < bdi.compress(page).size());
+    assert(compressed.size() < fpc.compress(page).size());
+    assert(compressed.size() < cpack.compress(page).size());
+
+    assert(adaptive.decompress(adaptive.compress(std::vector<uint8_t>())).empty());
+    std::cout << "Adaptive round trip test passed\n";
+}
+
+void testPredictedMatchesExhaustive() {
+    compression::Adaptive predicted;
+    compression::Adaptive exhaustive;
+    exhaustive.setSelection(compression::Adaptive::Selection::EXHAUSTIVE);
+    for (unsigned seed = 0; seed < 20; seed++) {
+        std::vector<uint8_t> page = makeMixedPage(200, seed);
+        assert(predicted.compress(page) == exhaustive.compress(page));
+    }
+    std::cout << "Predicted selection test passed\n";
+}
+
+void testEnabledCodecs() {
+    std::vector<uint8_t> page = makeMixedPage(300, 2);
+    for (uint8_t enabled : {0, 2, 4, 8, 6, 12}) {
+        compression::Adaptive adaptive(enabled);
+        std::vector<uint8_t> compressed = adaptive.compress(page);
+        assert(adaptive.decompress(compressed) == page);
+        for (int s = 1; s < 4; s++) {
+            assert((enabled >> s & 1) || adaptive.selectorCounts()[s] == 0);
+        }
+    }
+    std::cout << "Enabled codecs test passed\n";
+}
+
+void testCompressLines() {
+    compression::Adaptive adaptive;
+    std::vector<uint8_t> page = makeMixedPage(64, 3);
+    std::vector<uint8_t> payload;
+    std::vector<compression::CompressionBase::LineRecord> records;
+    adaptive.compressLines(page.data(), 64, payload, records);
+
+    // the record tag is the selector, lines decode on their own
+    size_t offset = 0;
+    for (size_t i = 0; i < 64; i++) {
+        assert(records[i].tag <= compression::Adaptive::CPACK_LINE);
+        assert((records[i].tag == compression::Adaptive::RAW) == (records[i].size == 64));
+        uint8_t line[64];
+        adaptive.decompressLines(payload.data() + offset, records[i].size, &records[i], 1, line);
+        assert(std::memcmp(line, page.data() + i * 64, 64) == 0);
+        offset += records[i].size;
+    }
+
+    std::vector<uint8_t> output(page.size());
+    adaptive.decompressLines(payload.data(), payload.size(), records.data(), 64, output.data());
+    assert(output == page);
+    std::cout << "Adaptive compress lines test passed\n";
+}
+
+void testMalformedInput() {
+    compression::Adaptive adaptive;
+    std::vector<uint8_t> compressed = adaptive.compress(makeMixedPage(10, 4));
+
+    auto rejects = [&](const std::vector<uint8_t>& input) {
+        try {
+            adaptive.decompress(input);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects(std::vector<uint8_t>(compressed.begin(), compressed.begin() + 3)));
+    assert(rejects(std::vector<uint8_t>(compressed.begin(), compressed.end() - 1)));
+    std::vector<uint8_t> bad = compressed;
+    bad[0] = 0xFF;
+    assert(rejects(bad));
+
+    std::mt19937 gen(5);
+    for (int i = 0; i < 500; i++) {
+        bad = compressed;
+        bad[gen() % bad.size()] ^= 1 << (gen() % 8);
+        rejects(bad);
+    }
+    std::cout << "Adaptive malformed input test passed\n";
+}
+
+int main() {
+    testRoundTrip();
+    testPredictedMatchesExhaustive();
+    testEnabledCodecs();
+    testCompressLines();
+    testMalformedInput();
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include "compression/ans.h"
+#include "compression/huffman.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+// tag-stream-like bytes: a few symbols, one of them dominant
+std::vector<uint8_t> makeSkewed(size_t size, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::discrete_distribution<int> tags({900, 50, 30, 15, 5});
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(tags(gen));
+    }
+    return data;
+}
+
+void testNormalizeCounts() {
+    uint32_t counts[6] = {1000, 1, 0, 3, 500000, 7};
+    uint16_t normalized[6];
+    compression::ANS::normalizeCounts(counts, 6, 10, normalized);
+    uint32_t sum = 0;
+    for (int s = 0; s < 6; s++) {
+        assert((normalized[s] == 0) == (counts[s] == 0));
+        sum += normalized[s];
+    }
+    assert(sum == 1024);
+    assert(normalized[4] > 1000);
+
+    bool threw = false;
+    try {
+        compression::ANS ans(compression::ANS::MAX_TABLE_LOG + 1);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "Normalize counts test passed\n";
+}
+
+void testNormalizeShrink() {
+    // the rounded up singletons overshoot 256, slots must come from where
+    // they cost least
+    const int num_symbols = 102;
+    const int table_log = 8;
+    uint32_t counts[num_symbols];
+    counts[0] = 10000;
+    counts[1] = 300;
+    for (int s = 2; s < num_symbols; s++) {
+        counts[s] = 1;
+    }
+    uint16_t normalized[num_symbols];
+    compression::ANS::normalizeCounts(counts, num_symbols, table_log, normalized);
+
+    double bits = 0;
+    uint32_t sum = 0;
+    for (int s = 0; s < num_symbols; s++) {
+        assert(normalized[s] >= 1);
+        bits += counts[s] * std::log2(256.0 / normalized[s]);
+        sum += normalized[s];
+    }
+    assert(sum == 256);
+    assert(bits < 10200);
+
+    // the cost is convex in each count, so no single slot moved from one
+    // symbol to another may lower it
+    auto cost = [&](int s, int n) { return counts[s] * std::log2(256.0 / n); };
+    for (int from = 0; from < num_symbols; from++) {
+        if (normalized[from] == 1) {
+            continue;
+        }
+        double loss = cost(from, normalized[from] - 1) - cost(from, normalized[from]);
+        for (int to = 0; to < num_symbols; to++) {
+            double gain = cost(to, normalized[to]) - cost(to, normalized[to] + 1);
+            assert(to == from || gain <= loss + 1e-9);
+        }
+    }
+    std::cout << "Normalize shrink test passed\n";
+}
+
+void testRoundTrip() {
+    compression::ANS ans;
+    std::mt19937 gen(7);
+    for (size_t size : {0, 1, 2, 17, 100, 1000, 65536, 300000}) {
+        for (int alphabet : {1, 2, 5, 40, 256}) {
+            std::vector<uint8_t> input(size);
+            std::geometric_distribution<int> symbol(alphabet == 1 ? 0.5 : 1.0 / alphabet);
+            for (auto& byte : input) {
+                byte = static_cast<uint8_t>(std::min(alphabet - 1, symbol(gen)));
+            }
+            std::vector<uint8_t> compressed = ans.compress(input);
+            assert(compressed.size() <= ans.maxCompressedSize(input.size()));
+            assert(ans.decompressedSize(compressed.data(), compressed.size()) == input.size());
+
+            // any instance decodes, whatever its table log
+            compression::ANS other(compression::ANS::MIN_TABLE_LOG);
+            assert(other.decompress(compressed) == input);
+        }
+    }
+    std::cout << "ANS round trip test passed\n";
+}
+
+void testNearEntropy() {
+    std::vector<uint8_t> input = makeSkewed(200000, 1);
+    double counts[5] = {};
+    for (uint8_t byte : input) {
+        counts[byte]++;
+    }
+    double entropy_bits = 0;
+    for (double count : counts) {
+        if (count > 0) {
+            entropy_bits -= count * std::log2(count / input.size());
+        }
+    }
+
+    compression::ANS ans;
+    std::vector<uint8_t> compressed = ans.compress(input);
+    assert(ans.decompress(compressed) == input);
+    double ans_bits = compressed.size() * 8.0;
+    std::cout << "entropy " << entropy_bits / 8 << " bytes, ANS " << compressed.size() << " bytes\n";
+    assert(ans_bits < entropy_bits * 1.01 + 256);
+
+    // Huffman needs a whole bit for the dominant symbol
+    HuffmanCompression huffman;
+    std::vector<uint8_t> huffman_compressed(HuffmanCompression::maxCompressedSize(input.size()));
+    size_t huffman_size = huffman.compress(input.data(), input.size(),
+                                           huffman_compressed.data(), huffman_compressed.size());
+    assert(compressed.size() * 3 < huffman_size * 2);
+    std::cout << "Near entropy test passed\n";
+}
+
+void testMalformedInput() {
+    compression::ANS ans;
+    std::vector<uint8_t> compressed = ans.compress(makeSkewed(5000, 2));
+    assert(compressed[4] == compression::ANS::CODED);
+
+    auto rejects = [&](const std::vector<uint8_t>& input) {
+        try {
+            ans.decompress(input);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects(std::vector<uint8_t>(compressed.begin(), compressed.begin() + 3)));
+    assert(rejects(std::vector<uint8_t>(compressed.begin(), compressed.end() - 1)));
+
+    // table log out of range, counts that do not sum to the table size
+    std::vector<uint8_t> bad = compressed;
+    bad[5] = 20;
+    assert(rejects(bad));
+    bad = compressed;
+    bad[7]++;
+    assert(rejects(bad));
+
+    // flipped bits decode to something or are caught, never overrun
+    std::mt19937 gen(3);
+    for (int i = 0; i < 200; i++) {
+        bad = compressed;
+        bad[5 + gen() % (bad.size() - 5)] ^= 1 << (gen() % 8);
+        rejects(bad);
+    }
+    std::cout << "ANS malformed input test passed\n";
+}
+
+int main() {
+    testNormalizeCounts();
+    testNormalizeShrink();
+    testRoundTrip();
+    testNearEntropy();
+    testMalformedInput();
+    return 0;
+}
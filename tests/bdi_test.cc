@@ -2,6 +2,8 @@
 #include <cassert>
 #include <iostream>
 #include <random>
+#include <stdexcept>
+#include <cstring>
 
 std::vector<uint8_t> generateTestInput(int base_size = 8, int delta_size = 2) {
     std::vector<uint8_t> input(64);  // 64 bytes total
@@ -90,9 +92,218 @@ void testSimpleCompression() {
     std::cout << "Simple BDI 4-2 compression test passed\n";
 }
 
+void testBufferCompression() {
+    compression::BDI bdi;
+    // four compressible lines and a partial trailing line
+    std::vector<uint8_t> input;
+    for (int i = 0; i < 4; i++) {
+        auto line = generateTestInput(8, 1);
+        input.insert(input.end(), line.begin(), line.end());
+    }
+    input.insert(input.end(), {1, 2, 3, 4, 5, 6, 7});
+
+    std::vector<uint8_t> compressed(bdi.maxCompressedSize(input.size()));
+    size_t compressed_size = bdi.compress(input.data(), input.size(),
+                                          compressed.data(), compressed.size());
+    assert(compressed_size < input.size());
+
+    size_t decompressed_size = bdi.decompressedSize(compressed.data(), compressed_size);
+    assert(decompressed_size == input.size());
+
+    std::vector<uint8_t> decompressed(decompressed_size);
+    size_t written = bdi.decompress(compressed.data(), compressed_size,
+                                    decompressed.data(), decompressed.size());
+    assert(written == input.size());
+    assert(decompressed == input);
+
+    // a destination that is one byte short must be rejected
+    bool thrown = false;
+    try {
+        bdi.compress(input.data(), input.size(), compressed.data(), compressed_size - 1);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "Buffer BDI compression test passed\n";
+}
+
+void testDeltaRanges() {
+    compression::BDI bdi;
+    std::mt19937 gen(42);
+
+    // values scattered around a base with growing spread, so every base and
+    // delta size is exercised
+    for (int spread = 1; spread < (1 << 20); spread *= 3) {
+        for (int base_size : {2, 4, 8}) {
+            std::vector<uint8_t> input(64);
+            uint64_t base = (uint64_t(gen()) << 32) | gen();
+            for (int i = 0; i < 64; i += base_size) {
+                uint64_t value = base + gen() % spread - spread / 2;
+                std::memcpy(&input[i], &value, base_size);
+            }
+            assert(bdi.decompress(bdi.compress(input)) == input);
+        }
+    }
+
+    // 4-byte values wrapping around zero still take 1-byte deltas
+    std::vector<uint8_t> input(64);
+    for (int i = 0; i < 64; i += 4) {
+        uint32_t value = 0xFFFFFFF0u + i;
+        std::memcpy(&input[i], &value, 4);
+    }
+    auto compressed = bdi.compress(input);
+    assert(bdi.getEncodingName(compressed[0]) == "BASE4_DELTA1");
+    assert(bdi.decompress(compressed) == input);
+    std::cout << "Delta range BDI test passed\n";
+}
+
+void testEncodingSelection() {
+    compression::BDI bdi;
+
+    std::vector<uint8_t> zeros(64, 0);
+    auto compressed = bdi.compress(zeros);
+    assert(compressed.size() == 1);
+    assert(bdi.getEncodingName(compressed[0]) == "ZEROS");
+    assert(bdi.decompress(compressed) == zeros);
+
+    std::vector<uint8_t> repeated(64);
+    for (int i = 0; i < 64; i++) {
+        repeated[i] = i % 8 + 1;
+    }
+    compressed = bdi.compress(repeated);
+    assert(compressed.size() == 9);
+    assert(bdi.getEncodingName(compressed[0]) == "REPEAT");
+    assert(bdi.decompress(compressed) == repeated);
+
+    // both selection modes decode back, and the ranked choice is never
+    // larger than the first fit
+    std::mt19937 gen(7);
+    compression::BDI first_fit;
+    first_fit.setSelection(compression::BDI::Selection::FIRST_FIT);
+    for (int i = 0; i < 1000; i++) {
+        std::vector<uint8_t> input = generateTestInput(2 << (i % 3), 1 + i % 2);
+        input[gen() % 64] ^= 1 << (gen() % 8);
+        auto smallest = bdi.compress(input);
+        auto first = first_fit.compress(input);
+        assert(smallest.size() <= first.size());
+        assert(bdi.decompress(smallest) == input);
+        assert(first_fit.decompress(first) == input);
+    }
+    std::cout << "Encoding selection BDI test passed\n";
+}
+
+void testDualBase() {
+    compression::BDI bdi;
+    std::mt19937 gen(3);
+
+    // pointers into one region mixed with small integers
+    std::vector<uint8_t> input(64);
+    for (int i = 0; i < 64; i += 8) {
+        uint64_t value = gen() % 2 ? 0x00007F3A12345600ull + gen() % 100 : gen() % 100;
+        std::memcpy(&input[i], &value, 8);
+    }
+    // keep both kinds present
+    uint64_t pointer = 0x00007F3A12345650ull;
+    uint64_t small = 7;
+    std::memcpy(&input[0], &small, 8);
+    std::memcpy(&input[8], &pointer, 8);
+
+    auto compressed = bdi.compress(input);
+    assert(bdi.getEncodingName(compressed[0]) == "UNCOMPRESSED");
+
+    bdi.setDualBase(true);
+    compressed = bdi.compress(input);
+    assert(bdi.getEncodingName(compressed[0]) == "DUAL_BASE8_DELTA1");
+    // encoding, 8-bit mask, base, 8 deltas
+    assert(compressed.size() == 1 + 1 + 8 + 8);
+
+    // any instance decodes dual-base lines
+    compression::BDI decoder;
+    assert(decoder.decompressedSize(compressed.data(), compressed.size()) == 64);
+    assert(decoder.decompress(compressed) == input);
+
+    // 2-byte elements mixing small values and values near a base
+    for (int i = 0; i < 64; i += 2) {
+        uint16_t value = gen() % 2 ? 0x9000 + gen() % 100 : gen() % 100;
+        std::memcpy(&input[i], &value, 2);
+    }
+    compressed = bdi.compress(input);
+    assert(compressed.size() < 64);
+    assert(decoder.decompress(compressed) == input);
+    std::cout << "Dual base BDI test passed\n";
+}
+
+void testCompressLines() {
+    compression::BDI bdi;
+    std::mt19937 gen(4);
+
+    // zero, repeated, narrow delta and random lines
+    std::vector<uint8_t> input(4 * 64, 0);
+    for (int i = 64; i < 128; i += 8) {
+        uint64_t value = 0x1234567890ull;
+        std::memcpy(&input[i], &value, 8);
+    }
+    for (int i = 128; i < 192; i += 4) {
+        uint32_t value = 1000 + gen() % 50;
+        std::memcpy(&input[i], &value, 4);
+    }
+    for (int i = 192; i < 256; i++) {
+        input[i] = gen();
+    }
+
+    std::vector<uint8_t> payload;
+    std::vector<compression::CompressionBase::LineRecord> records;
+    bdi.compressLines(input.data(), 4, payload, records);
+    assert(records.size() == 4);
+    assert(bdi.getEncodingName(records[0].tag) == "ZEROS" && records[0].size == 1);
+    assert(bdi.getEncodingName(records[1].tag) == "REPEAT" && records[1].size == 9);
+    assert(bdi.getEncodingName(records[2].tag) == "BASE4_DELTA1");
+    assert(bdi.getEncodingName(records[3].tag) == "UNCOMPRESSED" && records[3].size == 65);
+
+    // the batch is laid out like the stream form
+    assert(payload == bdi.compress(input));
+
+    std::vector<uint8_t> output(input.size());
+    bdi.decompressLines(payload.data(), payload.size(), records.data(), 4, output.data());
+    assert(output == input);
+    std::cout << "Compress lines BDI test passed\n";
+}
+
+void testStreaming() {
+    compression::BDI bdi;
+    std::mt19937 gen(5);
+    std::vector<uint8_t> input(64 * 20 + 17);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (i / 64) % 2 ? gen() : i / 64;
+    }
+
+    // feed uneven chunks that split lines
+    std::vector<uint8_t> compressed;
+    bdi.begin();
+    for (size_t i = 0; i < input.size();) {
+        size_t size = std::min<size_t>(1 + gen() % 100, input.size() - i);
+        std::vector<uint8_t> out(bdi.maxUpdateSize(size));
+        out.resize(bdi.update(input.data() + i, size, out.data(), out.size()));
+        compressed.insert(compressed.end(), out.begin(), out.end());
+        i += size;
+    }
+    std::vector<uint8_t> out(bdi.maxUpdateSize(0));
+    out.resize(bdi.finish(out.data(), out.size()));
+    compressed.insert(compressed.end(), out.begin(), out.end());
+
+    assert(compressed == bdi.compress(input));
+    assert(bdi.decompress(compressed) == input);
+    std::cout << "Streaming BDI test passed\n";
+}
 
 int main() {
     testSimpleCompression();
+    testBufferCompression();
+    testDeltaRanges();
+    testEncodingSelection();
+    testDualBase();
+    testCompressLines();
+    testStreaming();
     
     std::cout << "All BDI tests passed!\n";
     return 0;
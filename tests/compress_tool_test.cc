@@ -0,0 +1,81 @@
+// tests/compress_tool_test.cc
+//
+// Runs the compress command line tool, COMPRESS_TOOL, on files in
+// TEST_DIR.
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+const std::string dir = TEST_DIR;
+
+std::vector<char> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<char>& data) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(data.data(), data.size());
+}
+
+bool exists(const std::string& path) {
+    return std::ifstream(path).good();
+}
+
+// exit status of the tool with args, its stderr is dropped
+int tool(const std::string& args) {
+    std::string command = std::string(COMPRESS_TOOL) + " " + args + " 2>/dev/null";
+    return std::system(command.c_str());
+}
+
+void testCodecFromFile() {
+    // small integers, compressible by every codec
+    std::mt19937 gen(1);
+    std::vector<char> data(300000);
+    for (size_t i = 0; i < data.size(); i += 8) {
+        data[i] = static_cast<char>(gen() % 100);
+    }
+    std::string original = dir + "/tool_original.bin";
+    std::string packed = dir + "/tool_packed.cpk";
+    std::string restored = dir + "/tool_restored.bin";
+    writeFile(original, data);
+
+    assert(tool("-c cpack --chunk-size=65536 " + original + " " + packed) == 0);
+    assert(readFile(packed).size() < data.size());
+
+    // no -c: the codec comes from the file
+    assert(tool("-d " + packed + " " + restored) == 0);
+    assert(readFile(restored) == data);
+    assert(tool("-d -c cpack " + packed + " " + restored) == 0);
+    assert(readFile(restored) == data);
+    std::cout << "Codec from file test passed\n";
+}
+
+void testRejects() {
+    std::string packed = dir + "/tool_packed.cpk";
+    std::string restored = dir + "/tool_rejected.bin";
+
+    // a different codec fails without leaving output
+    assert(tool("-d -c lz4 " + packed + " " + restored) != 0);
+    assert(!exists(restored));
+
+    // files without the header
+    assert(tool("-d " + dir + "/tool_original.bin " + restored) != 0);
+    std::vector<char> bad = readFile(packed);
+    bad[4] = 100;
+    writeFile(dir + "/tool_bad.cpk", bad);
+    assert(tool("-d " + dir + "/tool_bad.cpk " + restored) != 0);
+    assert(!exists(restored));
+    std::cout << "Codec mismatch rejection test passed\n";
+}
+
+int main() {
+    testCodecFromFile();
+    testRejects();
+    return 0;
+}
@@ -103,10 +103,201 @@ void testMixedDataCompression() {
     std::cout << "Mixed data compression test passed\n";
 }
 
+void testBitPackedCodes() {
+    compression::CPack cpack;
+
+    // 16 zero words take 2 bits each
+    std::vector<uint8_t> zeros(64, 0);
+    assert(cpack.compress(zeros).size() == 4);
+
+    // one miss (34 bits) followed by 15 dictionary hits (6 bits each)
+    std::vector<uint8_t> repeated;
+    for (size_t i = 0; i < 16; i++) {
+        repeated.insert(repeated.end(), {0x78, 0x56, 0x34, 0x12});
+    }
+    auto compressed = cpack.compress(repeated);
+    assert(compressed.size() == (34 + 15 * 6 + 7) / 8);
+
+    // a fresh instance mirrors the dictionary while decoding
+    compression::CPack decoder;
+    assert(decoder.decompress(compressed) == repeated);
+
+    // partial matches and a trailing partial word
+    std::vector<uint8_t> input = {0x78, 0x56, 0x34, 0x12,  0x11, 0x56, 0x34, 0x12,
+                                  0x22, 0x33, 0x34, 0x12,  0x05, 0x00, 0x00, 0x00,
+                                  0xAA, 0xBB};
+    compressed = cpack.compress(input);
+    assert(compressed.size() == (34 + 16 + 24 + 12 + 6 + 16 + 7) / 8);
+    assert(decoder.decompressedSize(compressed.data(), compressed.size()) == input.size());
+    assert(decoder.decompress(compressed) == input);
+    std::cout << "Bit packed codes test passed\n";
+}
+
+void testDictionaryPartialMatch() {
+    Dictionary dict(4);
+    dict.insert(0x12345678, 0x12345678);
+    assert(dict.find_24bit(0x123456FF) == 0u);
+    assert(dict.find_16bit(0x1234FFFF) == 0u);
+    assert(!dict.find_24bit(0x12FF5678));
+
+    // push 0x12345678 out, its prefixes must go with it
+    for (uint32_t i = 1; i <= 4; i++) {
+        dict.insert(i << 24, i << 24);
+    }
+    assert(dict.size() == 4);
+    assert(!dict.find_exact(0x12345678));
+    assert(!dict.find_24bit(0x123456FF));
+    assert(!dict.find_16bit(0x1234FFFF));
+    // the evicted slot is reused
+    assert(dict.find_exact(0x04000000) == 0u);
+    assert(dict.find_16bit(0x0400ABCD) == 0u);
+
+    // larger dictionaries take wider indexes
+    compression::CPack cpack(1024);
+    std::vector<uint8_t> input;
+    for (uint32_t i = 0; i < 4096; i++) {
+        uint32_t word = (i % 1500) << 12 | (i & 0xFF);
+        for (int j = 0; j < 4; j++) {
+            input.push_back(word >> (j * 8));
+        }
+    }
+    assert(cpack.decompress(cpack.compress(input)) == input);
+    std::cout << "Dictionary partial match test passed\n";
+}
+
+void testFixedDictionary() {
+    FixedDictionary<16> dict;
+    for (uint32_t i = 0; i < 16; i++) {
+        assert(dict.insert(0x1000 * (i + 1)) == i);
+    }
+    assert(dict.find_exact(0x3000) == 2u);
+    assert(dict.find_16bit(0x0000FFFF) == 0u);
+    assert(dict.find_24bit(0x000030AB) == 2u);
+    assert(!dict.find_exact(0xDEAD));
+
+    // the first slot not used since the pseudo-LRU bits were reset goes
+    uint32_t slot = dict.insert(0xDEAD0000);
+    assert(slot != 0 && slot != 2);
+    assert(dict.at(slot) == 0xDEAD0000);
+    assert(dict.size() == 16);
+
+    FixedDictionary<8, DictReplacement::FIFO> fifo;
+    for (uint32_t i = 0; i < 10; i++) {
+        fifo.insert(i + 1);
+    }
+    // 1 and 2 were replaced in insertion order
+    assert(fifo.at(0) == 9 && fifo.at(1) == 10);
+    assert(!fifo.find_exact(1) && fifo.find_exact(3) == 2u);
+    std::cout << "Fixed dictionary test passed\n";
+}
+
+void testMatchKernels() {
+    alignas(64) uint32_t keys[64];
+    for (uint32_t i = 0; i < 64; i++) {
+        keys[i] = (i % 5) * 0x01010101u ^ (i << 8);
+    }
+    std::vector<dict_kernel::MatchFn> kernels = {dict_kernel::matcher()};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    kernels.push_back(dict_kernel::matchSSE2);
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(dict_kernel::matchAVX2);
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        kernels.push_back(dict_kernel::matchAVX512);
+    }
+#endif
+    for (size_t n = 4; n <= 64; n += 4) {
+        for (uint32_t mask : {0xFFFFFFFFu, 0xFFFFFF00u, 0xFFFF0000u}) {
+            for (uint32_t key : {keys[0], keys[n - 1], keys[n / 2] ^ 0x12u, 0xDEADBEEFu}) {
+                uint64_t expected = dict_kernel::matchScalar(keys, n, key, mask);
+                for (dict_kernel::MatchFn kernel : kernels) {
+                    assert(kernel(keys, n, key, mask) == expected);
+                }
+            }
+        }
+    }
+    std::cout << "Match kernels test passed\n";
+}
+
+void testCompressLines() {
+    compression::CPack cpack;
+    std::vector<uint8_t> input(3 * 64, 0);
+    for (size_t i = 64; i < input.size(); i++) {
+        input[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    std::vector<uint8_t> payload;
+    std::vector<compression::CompressionBase::LineRecord> records;
+    cpack.compressLines(input.data(), 3, payload, records);
+    // 16 zero codes of 2 bits
+    assert(records[0].size == 4);
+
+    // every line decodes on its own
+    size_t offset = 0;
+    for (size_t i = 0; i < 3; i++) {
+        std::vector<uint8_t> line(payload.begin() + offset,
+                                  payload.begin() + offset + records[i].size);
+        assert(cpack.decompress(line) ==
+               std::vector<uint8_t>(input.begin() + i * 64, input.begin() + (i + 1) * 64));
+        offset += records[i].size;
+    }
+    assert(offset == payload.size());
+
+    std::vector<uint8_t> output(input.size());
+    cpack.decompressLines(payload.data(), payload.size(), records.data(), 3, output.data());
+    assert(output == input);
+    std::cout << "Compress lines test passed\n";
+}
+
+void testStreaming() {
+    compression::CPack cpack;
+    std::vector<uint8_t> input;
+    for (uint32_t i = 0; i < 500; i++) {
+        uint32_t word = i % 3 ? 0x12345600 + i % 7 : i * 2654435761u;
+        for (int j = 0; j < 4; j++) {
+            input.push_back(word >> (j * 8));
+        }
+    }
+    input.push_back(0xAB);
+    input.push_back(0xCD);
+
+    // chunk sizes that split words, the dictionary and the bit stream
+    // carry over between updates
+    std::vector<uint8_t> compressed;
+    cpack.begin();
+    size_t sizes[] = {1, 2, 3, 5, 7, 64, 13};
+    for (size_t i = 0, n = 0; i < input.size(); n++) {
+        size_t size = std::min(sizes[n % 7], input.size() - i);
+        std::vector<uint8_t> out(cpack.maxUpdateSize(size));
+        out.resize(cpack.update(input.data() + i, size, out.data(), out.size()));
+        compressed.insert(compressed.end(), out.begin(), out.end());
+        i += size;
+    }
+    std::vector<uint8_t> out(cpack.maxUpdateSize(0));
+    out.resize(cpack.finish(out.data(), out.size()));
+    compressed.insert(compressed.end(), out.begin(), out.end());
+
+    assert(compressed == cpack.compress(input));
+    assert(cpack.decompress(compressed) == input);
+    std::cout << "Streaming test passed\n";
+}
+
 int main() {
     testZeroCompression();
 
+    testDictionaryPartialMatch();
+
+    testFixedDictionary();
+    testMatchKernels();
+
     testMixedDataCompression();
+
+    testBitPackedCodes();
+
+    testCompressLines();
+
+    testStreaming();
     
     std::cout << "All tests passed!\n";
 
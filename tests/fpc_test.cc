@@ -24,9 +24,51 @@ void testRepeatedValue() {
     std::cout << "Repeated value FPC compression test passed\n";
 }
 
+void testBufferCompression() {
+    compression::FPC fpc;
+    // mixed words and a partial trailing word
+    std::vector<uint8_t> input = {0, 0, 0, 0, 7, 7, 7, 7, 1, 2, 0, 0,
+                                  1, 2, 3, 4, 0, 0};
+
+    std::vector<uint8_t> compressed(fpc.maxCompressedSize(input.size()));
+    size_t compressed_size = fpc.compress(input.data(), input.size(),
+                                          compressed.data(), compressed.size());
+    assert(fpc.decompressedSize(compressed.data(), compressed_size) == input.size());
+
+    std::vector<uint8_t> decompressed(input.size());
+    size_t written = fpc.decompress(compressed.data(), compressed_size,
+                                    decompressed.data(), decompressed.size());
+    assert(written == input.size());
+    assert(decompressed == input);
+    std::cout << "Buffer FPC compression test passed\n";
+}
+
+void testStreaming() {
+    compression::FPC fpc;
+    std::vector<uint8_t> input = {0, 0, 0, 0, 7, 7, 7, 7, 1, 2, 0, 0,
+                                  1, 2, 3, 4, 0, 0, 9};
+
+    // one byte at a time carries partial words across every call
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> out(fpc.maxUpdateSize(1));
+    fpc.begin();
+    for (uint8_t byte : input) {
+        size_t written = fpc.update(&byte, 1, out.data(), out.size());
+        compressed.insert(compressed.end(), out.begin(), out.begin() + written);
+    }
+    size_t written = fpc.finish(out.data(), out.size());
+    compressed.insert(compressed.end(), out.begin(), out.begin() + written);
+
+    assert(compressed == fpc.compress(input));
+    assert(fpc.decompress(compressed) == input);
+    std::cout << "Streaming FPC test passed\n";
+}
+
 int main() {
     testZeroPattern();
     testRepeatedValue();
+    testBufferCompression();
+    testStreaming();
     
     std::cout << "All FPC tests passed!\n";
     return 0;
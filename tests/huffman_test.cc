@@ -1,29 +1,218 @@
 #include <iostream>
 #include <string>
-#include "compression/huffman.h"  // Assuming your Huffman implementation is in this file
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include "compression/huffman.h"
 
-int main() {
-    // Test case 1: Simple string compression
+void testRoundTrip() {
     std::string test_string = "hello world! this is a test string for huffman compression";
-    std::cout << "Original string: " << test_string << std::endl;
     std::cout << "Original size: " << test_string.size() << " bytes" << std::endl;
 
-    // Compress
     HuffmanCompression huffman;
     std::string compressed = huffman.compress(test_string);
     std::cout << "Compressed size: " << compressed.size() << " bytes" << std::endl;
-    std::cout << "Compressed string: " << compressed << std::endl;
+    // too short to pay for the code lengths, stored as is
+    assert(compressed.size() == HuffmanCompression::maxCompressedSize(test_string.size()));
 
-    // Decompress
     std::string decompressed = huffman.decompress(compressed);
-    std::cout << "Decompressed string: " << decompressed << std::endl;
+    assert(decompressed == test_string);
+
+    // longer text takes the four symbols per load path
+    std::string text;
+    for (int i = 0; i < 2000; i++) {
+        text += "the quick brown fox jumps over the lazy dog " + std::to_string(i * 31) + "\n";
+    }
+    compressed = huffman.compress(text);
+    assert(compressed[4] == HuffmanCompression::HUFFMAN);
+    assert(compressed.size() < text.size() * 3 / 4);
+    assert(huffman.decompress(compressed) == text);
+    std::cout << "Round trip test passed." << std::endl;
+}
+
+void testEdgeCases() {
+    HuffmanCompression huffman;
+
+    std::string empty;
+    assert(huffman.decompress(huffman.compress(empty)) == empty);
+
+    // one distinct byte is run length coded
+    std::string run(1000, 'z');
+    std::string compressed = huffman.compress(run);
+    assert(compressed.size() == HuffmanCompression::HEADER_SIZE + 1);
+    assert(huffman.decompress(compressed) == run);
+
+    // uniform bytes do not shrink and are stored
+    std::string uniform;
+    unsigned seed = 3;
+    for (int i = 0; i < 4096; i++) {
+        seed = seed * 1103515245 + 12345;
+        uniform += static_cast<char>(seed >> 16);
+    }
+    compressed = huffman.compress(uniform);
+    assert(compressed[4] == HuffmanCompression::RAW);
+    assert(compressed.size() == HuffmanCompression::maxCompressedSize(uniform.size()));
+    assert(huffman.decompress(compressed) == uniform);
 
-    // Verify
-    if (test_string == decompressed) {
-        std::cout << "Test PASSED: Original and decompressed strings match!" << std::endl;
-    } else {
-        std::cout << "Test FAILED: Strings don't match!" << std::endl;
+    std::string two = "abababababbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbaaa";
+    assert(huffman.decompress(huffman.compress(two)) == two);
+    std::cout << "Edge cases test passed." << std::endl;
+}
+
+void testLengthLimit() {
+    // Fibonacci frequencies give an unlimited Huffman code one more bit per
+    // symbol, far past the limit
+    std::string data;
+    uint64_t a = 1, b = 1;
+    for (int s = 0; s < 24; s++) {
+        data += std::string(a, static_cast<char>('A' + s));
+        uint64_t c = a + b;
+        a = b;
+        b = c;
+    }
+
+    HuffmanCompression huffman;
+    std::string compressed = huffman.compress(data);
+    assert(compressed[4] == HuffmanCompression::HUFFMAN);
+    assert(huffman.decompress(compressed) == data);
+
+    // the stored code lengths respect the limit
+    int max_symbol = static_cast<uint8_t>(compressed[5]);
+    for (int s = 0; s <= max_symbol; s++) {
+        int length = (static_cast<uint8_t>(compressed[6 + s / 2]) >> (s % 2 * 4)) & 0xF;
+        assert(length <= HUF_MAX_CODE_LENGTH);
+    }
+    std::cout << "Length limit test passed." << std::endl;
+}
+
+void testMalformedInput() {
+    HuffmanCompression huffman;
+    std::string text;
+    for (int i = 0; i < 50; i++) {
+        text += "a few words, a few more words, and some more words again";
     }
+    std::string compressed = huffman.compress(text);
+    assert(compressed[4] == HuffmanCompression::HUFFMAN);
 
+    auto rejects = [&](const std::string& input) {
+        try {
+            huffman.decompress(input);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    assert(rejects(compressed.substr(0, 3)));
+    assert(rejects(compressed.substr(0, compressed.size() - 2)));
+
+    // code lengths that do not fill the code space
+    std::string bad = compressed;
+    bad[6] = 0x11;
+    assert(rejects(bad));
+    std::cout << "Malformed input test passed." << std::endl;
+}
+
+void testSelfDescribing() {
+    std::string a, b;
+    for (int i = 0; i < 500; i++) {
+        a += "GET /index.html HTTP/1.1\r\n";
+        b += static_cast<char>(i % 7 * 3);
+    }
+
+    // every output decodes with a fresh instance, in any order
+    HuffmanCompression encoder;
+    std::string compressed_a = encoder.compress(a);
+    std::string compressed_b = encoder.compress(b);
+    HuffmanCompression decoder;
+    assert(decoder.decompress(compressed_b) == b);
+    assert(decoder.decompress(compressed_a) == a);
+    assert(decoder.decompress(compressed_b) == b);
+    assert(encoder.decompress(compressed_a) == a);
+    std::cout << "Self describing test passed." << std::endl;
+}
+
+void testSharedTable() {
+    // one table for many small messages, shipped separately
+    std::string sample;
+    for (int i = 0; i < 100; i++) {
+        sample += "key=" + std::to_string(i * 17) + ";value=" + std::to_string(i * i) + "\n";
+    }
+    HuffmanCompression encoder;
+    encoder.buildTable(reinterpret_cast<const uint8_t*>(sample.data()), sample.size());
+    uint8_t table[HuffmanCompression::MAX_TABLE_SIZE];
+    size_t table_size = encoder.writeTable(table, sizeof(table));
+
+    HuffmanCompression decoder;
+    assert(!decoder.hasTable());
+    assert(decoder.readTable(table, table_size) == table_size);
+
+    size_t total = 0;
+    size_t coded = 0;
+    for (int i = 1000; i < 1100; i++) {
+        std::string message = "key=" + std::to_string(i) + ";value=" + std::to_string(i * 3) + "\n";
+        std::vector<uint8_t> compressed(HuffmanCompression::maxTableCompressedSize(message.size()));
+        size_t size = encoder.compressWithTable(reinterpret_cast<const uint8_t*>(message.data()),
+                                                message.size(), compressed.data(), compressed.size());
+        std::string output(message.size(), '\0');
+        assert(decoder.decompressWithTable(compressed.data(), size,
+                                           reinterpret_cast<uint8_t*>(&output[0]),
+                                           output.size()) == message.size());
+        assert(output == message);
+        total += message.size();
+        coded += size;
+    }
+    // no per message table, only the 4 size bytes on top of the codes
+    assert(coded - 100 * 4 < total * 5 / 8);
+
+    // bytes the samples lack still have codes
+    std::string other = "\x01\x02 UPPER CASE";
+    std::vector<uint8_t> compressed(HuffmanCompression::maxTableCompressedSize(other.size()));
+    size_t size = encoder.compressWithTable(reinterpret_cast<const uint8_t*>(other.data()),
+                                            other.size(), compressed.data(), compressed.size());
+    std::string output(other.size(), '\0');
+    decoder.decompressWithTable(compressed.data(), size,
+                                reinterpret_cast<uint8_t*>(&output[0]), output.size());
+    assert(output == other);
+    std::cout << "Shared table test passed." << std::endl;
+}
+
+void testFourStreams() {
+    HuffmanCompression huffman;
+    unsigned seed = 11;
+    for (size_t size : {1023, 1024, 1025, 1026, 1027, 4099, 100000}) {
+        std::string data;
+        for (size_t i = 0; i < size; i++) {
+            seed = seed * 1103515245 + 12345;
+            data += "aaaabbbcdeffghij"[(seed >> 16) % 16];
+        }
+        std::string compressed = huffman.compress(data);
+        assert(compressed[4] == HuffmanCompression::HUFFMAN);
+        assert(huffman.decompress(compressed) == data);
+
+        if (size >= HuffmanCompression::FOUR_STREAM_MIN) {
+            // a stream that claims more bytes than there are
+            size_t jump = HuffmanCompression::HEADER_SIZE + 1 + static_cast<uint8_t>(compressed[5]) / 2 + 1;
+            std::string bad = compressed;
+            bad[jump + 3] = '\x7f';
+            bool thrown = false;
+            try {
+                huffman.decompress(bad);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+    std::cout << "Four streams test passed." << std::endl;
+}
+
+int main() {
+    testRoundTrip();
+    testEdgeCases();
+    testLengthLimit();
+    testMalformedInput();
+    testSelfDescribing();
+    testSharedTable();
+    testFourStreams();
     return 0;
-}
\ No newline at end of file
+}
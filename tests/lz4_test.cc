@@ -1,7 +1,10 @@
 // tests/lz4_test.cc
 #include "compression/lz4.h"
+#include "compression/lz4_frame.h"
+#include "compression/xxhash.h"
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <cassert>
 
 void testVectorCompression() {
@@ -50,10 +53,366 @@ void testCharacterRepeat() {
     std::cout << "Character repeat test passed." << std::endl;
 }
 
+void testMatchFinder() {
+    // long runs need extension bytes for both lengths, text gives short
+    // matches at many offsets
+    std::vector<char> data(1000, 'a');
+    std::string text = "the quick brown fox jumps over the lazy dog; ";
+    for (int i = 0; i < 200; i++) {
+        data.insert(data.end(), text.begin(), text.end());
+        data.push_back(static_cast<char>(i));
+    }
+    for (int i = 0; i < 600; i++) {
+        data.push_back(static_cast<char>(i * 7919 >> 3));
+    }
+
+    LZ4Compressor compressor;
+    std::vector<char> compressed = compressor.compress(data);
+    assert(compressed.size() < data.size() / 4);
+    assert(compressor.decompress(compressed) == data);
+
+    // reusing the instance starts from a clean table
+    assert(compressor.compress(data) == compressed);
+
+    // higher acceleration still round trips
+    for (int acceleration : {2, 8, 64}) {
+        compressor.setAcceleration(acceleration);
+        assert(compressor.decompress(compressor.compress(data)) == data);
+    }
+    std::cout << "Match finder test passed." << std::endl;
+}
+
+void testBlockFormat() {
+    // 'x' once, then a 12-byte match at offset 1 and 5 closing literals
+    std::vector<char> data(18, 'x');
+    LZ4Compressor compressor;
+    std::vector<char> compressed = compressor.compress(data);
+    std::vector<char> expected = {0x18, 'x', 0x01, 0x00, 0x50, 'x', 'x', 'x', 'x', 'x'};
+    assert(compressed == expected);
+    std::cout << "Block format test passed." << std::endl;
+}
+
+void testHighCompression() {
+    // words from a small vocabulary give many overlapping candidates
+    std::vector<char> data;
+    const char* words[] = {"load ", "store ", "branch ", "add ", "mul ", "0x7f3a12 ", "0x7f3a34 "};
+    unsigned seed = 1;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245 + 12345;
+        const char* word = words[(seed >> 16) % 7];
+        data.insert(data.end(), word, word + strlen(word));
+    }
+
+    LZ4Compressor fast;
+    LZ4Compressor hc;
+    hc.setMode(LZ4Compressor::Mode::HC);
+    std::vector<char> fast_compressed = fast.compress(data);
+    std::vector<char> hc_compressed = hc.compress(data);
+    assert(hc_compressed.size() < fast_compressed.size());
+
+    // same block format, any instance decodes it
+    assert(fast.decompress(hc_compressed) == data);
+
+    // a deeper search never does worse here
+    hc.setMaxAttempts(4);
+    std::vector<char> shallow = hc.compress(data);
+    assert(fast.decompress(shallow) == data);
+    assert(hc_compressed.size() <= shallow.size());
+    std::cout << "High compression test passed." << std::endl;
+}
+
+void testOverlappingMatches() {
+    // repeated patterns of every short period decode through overlapping copies
+    for (size_t period = 1; period <= 20; period++) {
+        std::vector<char> data;
+        for (size_t i = 0; i < 300; i++) {
+            data.push_back(static_cast<char>('a' + i % period));
+        }
+        LZ4Compressor compressor;
+        std::vector<char> compressed = compressor.compress(data);
+        assert(compressed.size() < 40);
+        assert(compressor.decompress(compressed) == data);
+    }
+    std::cout << "Overlapping matches test passed." << std::endl;
+}
+
+void testMalformedInput() {
+    std::vector<char> data;
+    for (int i = 0; i < 5000; i++) {
+        data.push_back(static_cast<char>(i % 251 < 100 ? i % 7 : i * 13));
+    }
+    LZ4Compressor compressor;
+    std::vector<char> compressed = compressor.compress(data);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(compressed.data());
+    std::vector<uint8_t> output(data.size());
+
+    // an output buffer one byte short is detected
+    bool thrown = false;
+    try {
+        compressor.decompress(src, compressed.size(), output.data(), output.size() - 1);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // a match reaching before the start of the output
+    const uint8_t bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+    thrown = false;
+    try {
+        compressor.decompress(bad_offset, sizeof(bad_offset), output.data(), output.size());
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // truncated and corrupted blocks either throw or stay in bounds
+    unsigned seed = 7;
+    for (int i = 0; i < 2000; i++) {
+        std::vector<uint8_t> corrupt(src, src + compressed.size());
+        seed = seed * 1103515245 + 12345;
+        corrupt.resize((seed >> 8) % corrupt.size() + 1);
+        seed = seed * 1103515245 + 12345;
+        corrupt[(seed >> 8) % corrupt.size()] ^= static_cast<uint8_t>(seed >> 24);
+        try {
+            size_t written = compressor.decompress(corrupt.data(), corrupt.size(),
+                                                   output.data(), output.size());
+            assert(written <= output.size());
+        } catch (const std::runtime_error&) {
+        }
+    }
+    std::cout << "Malformed input test passed." << std::endl;
+}
+
+void testXXHash() {
+    const uint8_t* text = reinterpret_cast<const uint8_t*>("abc");
+    assert(compression::xxhash32(text, 0) == 0x02CC5D05);
+    assert(compression::xxhash32(text, 3) == 0x32D153FF);
+    std::cout << "xxHash test passed." << std::endl;
+}
+
+std::vector<uint8_t> frameInput() {
+    std::vector<uint8_t> data;
+    unsigned seed = 3;
+    for (int i = 0; i < 300000; i++) {
+        seed = seed * 1103515245 + 12345;
+        // runs of text, small values and noise
+        data.push_back(i % 3000 < 1000 ? "load store "[i % 11] :
+                       i % 3000 < 2000 ? (seed >> 16) % 4 : seed >> 16);
+    }
+    return data;
+}
+
+void testFrameFormat() {
+    std::vector<uint8_t> data = frameInput();
+
+    // every option combination round trips
+    for (int options = 0; options < 16; options++) {
+        compression::LZ4Frame frame;
+        frame.setBlockSize(compression::LZ4Frame::BlockSize::KB64);
+        frame.setBlockIndependence(options & 1);
+        frame.setContentSize(options & 2);
+        frame.setBlockChecksum(options & 4);
+        frame.setContentChecksum(options & 8);
+        std::vector<uint8_t> compressed = frame.compress(data);
+        assert(compressed.size() < data.size() * 3 / 4);
+        assert(compressed.size() <= frame.maxCompressedSize(data.size()));
+        assert(frame.decompressedSize(compressed.data(), compressed.size()) == data.size());
+
+        // the options come from the frame header, not the instance
+        compression::LZ4Frame reader;
+        assert(reader.decompress(compressed) == data);
+    }
+
+    // linked blocks match across block boundaries
+    compression::LZ4Frame independent;
+    compression::LZ4Frame linked;
+    independent.setBlockSize(compression::LZ4Frame::BlockSize::KB64);
+    linked.setBlockSize(compression::LZ4Frame::BlockSize::KB64);
+    linked.setBlockIndependence(false);
+    assert(linked.compress(data).size() < independent.compress(data).size());
+
+    // a frame written by the lz4 command line tool (independent blocks,
+    // block and content checksums, content size)
+    const uint8_t stock[] = {
+        0x04, 0x22, 0x4d, 0x18, 0x7c, 0x40, 0xea, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0xb2, 0x35, 0x00, 0x00, 0x00, 0xf6, 0x12, 0x74, 0x72, 0x61,
+        0x63, 0x65, 0x20, 0x6c, 0x69, 0x6e, 0x65, 0x3a, 0x20, 0x6c, 0x6f, 0x61,
+        0x64, 0x20, 0x30, 0x78, 0x37, 0x66, 0x33, 0x61, 0x31, 0x32, 0x33, 0x34,
+        0x20, 0x73, 0x74, 0x6f, 0x72, 0x65, 0x11, 0x00, 0x1f, 0x38, 0x21, 0x00,
+        0x0e, 0x1f, 0x0a, 0x4e, 0x00, 0x84, 0x50, 0x31, 0x32, 0x33, 0x38, 0x0a,
+        0x12, 0x50, 0x97, 0x19, 0x00, 0x00, 0x00, 0x00, 0xc9, 0xd2, 0xfd, 0x4b
+    };
+    std::string line = "trace line: load 0x7f3a1234 store 0x7f3a1238 load 0x7f3a1234 store 0x7f3a1238\n";
+    std::string expected = line + line + line;
+    compression::LZ4Frame reader;
+    std::vector<uint8_t> decoded = reader.decompress(std::vector<uint8_t>(stock, stock + sizeof(stock)));
+    assert(std::string(decoded.begin(), decoded.end()) == expected);
+
+    // a flipped bit fails the content checksum
+    std::vector<uint8_t> corrupt(stock, stock + sizeof(stock));
+    corrupt[30] ^= 1;
+    bool thrown = false;
+    try {
+        reader.decompress(corrupt);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "Frame format test passed." << std::endl;
+}
+
+void testFrameBlockIndex() {
+    std::vector<uint8_t> data = frameInput();
+    compression::LZ4Frame frame;
+    frame.setBlockSize(compression::LZ4Frame::BlockSize::KB64);
+    std::vector<uint8_t> compressed = frame.compress(data);
+
+    // any block decodes on its own
+    auto blocks = frame.blockIndex(compressed.data(), compressed.size());
+    assert(blocks.size() == (data.size() + 65535) / 65536);
+    const auto& block = blocks[2];
+    std::vector<uint8_t> output(block.decompressed_size);
+    frame.decompressBlock(compressed.data(), compressed.size(), block,
+                          output.data(), output.size());
+    assert(std::equal(output.begin(), output.end(), data.begin() + block.decompressed_offset));
+
+    // and all of them in parallel
+    compression::ThreadPool pool(4);
+    frame.setThreadPool(&pool);
+    assert(frame.decompress(compressed) == data);
+    std::cout << "Frame block index test passed." << std::endl;
+}
+
+void testDictionary() {
+    // small JSON-like records that share most of their structure
+    auto record = [](unsigned i) {
+        std::string s = "{\"id\":" + std::to_string(i * 7919) +
+                        ",\"user\":\"user" + std::to_string(i % 97) +
+                        "\",\"status\":\"" + (i % 3 ? "active" : "suspended") +
+                        "\",\"region\":\"eu-west-1\",\"tags\":[\"alpha\",\"beta\"]}";
+        return std::vector<uint8_t>(s.begin(), s.end());
+    };
+    std::vector<std::vector<uint8_t>> samples;
+    for (unsigned i = 0; i < 200; i++) {
+        samples.push_back(record(i));
+    }
+    std::vector<uint8_t> dict = LZ4Compressor::trainDictionary(samples, 4096);
+    assert(!dict.empty() && dict.size() <= 4096);
+
+    LZ4Compressor lz4;
+    lz4.loadDictionary(dict.data(), dict.size());
+    size_t plain_total = 0;
+    size_t dict_total = 0;
+    for (unsigned i = 1000; i < 1050; i++) {
+        std::vector<uint8_t> input = record(i);
+        std::vector<uint8_t> compressed(LZ4Compressor::compressBound(input.size()));
+        std::vector<uint8_t> output(input.size());
+
+        size_t size = lz4.compressWithDictionary(input.data(), input.size(),
+                                                 compressed.data(), compressed.size());
+        assert(LZ4Compressor::decompressWithDictionary(compressed.data(), size,
+                                                       output.data(), output.size(),
+                                                       dict.data(), dict.size()) == input.size());
+        assert(output == input);
+        dict_total += size;
+
+        // the table goes back to the dictionary state, same input same output
+        std::vector<uint8_t> again(compressed.size());
+        assert(lz4.compressWithDictionary(input.data(), input.size(),
+                                          again.data(), again.size()) == size);
+        assert(std::equal(again.begin(), again.begin() + size, compressed.begin()));
+
+        // a plain compression in between does not leak the dictionary
+        std::vector<char> plain = lz4.compress(std::vector<char>(input.begin(), input.end()));
+        assert(lz4.decompress(plain) == std::vector<char>(input.begin(), input.end()));
+        plain_total += plain.size();
+    }
+    assert(dict_total * 2 < plain_total);
+
+    // HC mode searches the dictionary as well, from chains primed once
+    lz4.setMode(LZ4Compressor::Mode::HC);
+    LZ4Compressor fresh;
+    fresh.setMode(LZ4Compressor::Mode::HC);
+    for (unsigned i = 5000; i < 5020; i++) {
+        std::vector<uint8_t> input = record(i);
+        std::vector<uint8_t> compressed(LZ4Compressor::compressBound(input.size()));
+        std::vector<uint8_t> output(input.size());
+        size_t size = lz4.compressWithDictionary(input.data(), input.size(),
+                                                 compressed.data(), compressed.size());
+        assert(size * 2 < input.size());
+        assert(LZ4Compressor::decompressWithDictionary(compressed.data(), size,
+                                                       output.data(), output.size(),
+                                                       dict.data(), dict.size()) == input.size());
+        assert(output == input);
+
+        // the chains go back to the dictionary state, also after a plain
+        // HC compression, and match a compressor that just loaded it
+        std::vector<char> plain = lz4.compress(std::vector<char>(input.begin(), input.end()));
+        assert(lz4.decompress(plain) == std::vector<char>(input.begin(), input.end()));
+        std::vector<uint8_t> again(compressed.size());
+        assert(lz4.compressWithDictionary(input.data(), input.size(),
+                                          again.data(), again.size()) == size);
+        assert(std::equal(again.begin(), again.begin() + size, compressed.begin()));
+
+        fresh.loadDictionary(dict.data(), dict.size());
+        assert(fresh.compressWithDictionary(input.data(), input.size(),
+                                            again.data(), again.size()) == size);
+        assert(std::equal(again.begin(), again.begin() + size, compressed.begin()));
+    }
+    std::cout << "Dictionary test passed." << std::endl;
+}
+
+void testContextReuse() {
+    // a reused compressor gives the same blocks as a fresh one
+    std::vector<uint8_t> data;
+    unsigned seed = 7;
+    for (int i = 0; i < 200000; i++) {
+        seed = seed * 1103515245 + 12345;
+        data.push_back("abcdefgh"[(seed >> 16) % 8]);
+    }
+
+    LZ4Compressor reused;
+    std::vector<uint8_t> expected(LZ4Compressor::compressBound(data.size()));
+    std::vector<uint8_t> actual(expected.size());
+    std::vector<uint8_t> output(data.size());
+    for (size_t size : {100, 5000, 70000, 30, 200000, 1000}) {
+        LZ4Compressor fresh;
+        size_t n = fresh.compress(data.data(), size, expected.data(), expected.size());
+        assert(reused.compress(data.data(), size, actual.data(), actual.size()) == n);
+        assert(std::equal(expected.begin(), expected.begin() + n, actual.begin()));
+
+        // the stack table mode round trips the same inputs
+        if (size <= LZ4_SMALL_MAX_INPUT) {
+            size_t small = LZ4Compressor::compressSmall(data.data(), size, actual.data(), actual.size());
+            assert(LZ4Compressor::decompress(actual.data(), small, output.data(), output.size()) == size);
+            assert(std::equal(output.begin(), output.begin() + size, data.begin()));
+        }
+    }
+
+    bool thrown = false;
+    try {
+        LZ4Compressor::compressSmall(data.data(), LZ4_SMALL_MAX_INPUT + 1, actual.data(), actual.size());
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "Context reuse test passed." << std::endl;
+}
+
 int main() {
     testVectorCompression();
     testEmptyData();
-    //testCharacterRepeat();
+    testCharacterRepeat();
     testSingleCharacter();
+    testMatchFinder();
+    testBlockFormat();
+    testHighCompression();
+    testOverlappingMatches();
+    testMalformedInput();
+    testXXHash();
+    testFrameFormat();
+    testFrameBlockIndex();
+    testDictionary();
+    testContextReuse();
     return 0;
 }
\ No newline at end of file
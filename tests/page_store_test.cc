@@ -0,0 +1,198 @@
+#include "compression/page_store.h"
+#include "compression/adaptive.h"
+#include "compression/bdi.h"
+#include "compression/cpack.h"
+#include "compression/fpc.h"
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+using compression::PageStore;
+
+// pages of zeros, small ints, pointers and random bytes
+std::vector<uint8_t> makePages(size_t num_pages, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> data(num_pages * PageStore::PAGE_SIZE);
+    for (size_t page = 0; page < num_pages; page++) {
+        uint8_t* p = data.data() + page * PageStore::PAGE_SIZE;
+        int kind = gen() % 4;
+        for (size_t i = 0; i < PageStore::PAGE_SIZE; i += 8) {
+            uint64_t value = 0;
+            if (kind == 1) {
+                value = gen() % 1000;
+            } else if (kind == 2) {
+                value = 0x00007f3a12400000 + (gen() % 512) * 8;
+            } else if (kind == 3) {
+                value = (uint64_t(gen()) << 32) | gen();
+            }
+            std::memcpy(p + i, &value, 8);
+        }
+    }
+    return data;
+}
+
+template<typename Codec>
+PageStore::CodecFactory factory() {
+    return [] { return std::make_unique<Codec>(); };
+}
+
+void testRoundTrip(const char* name, PageStore::CodecFactory make) {
+    const size_t num_pages = 32;
+    std::vector<uint8_t> data = makePages(num_pages, 1);
+    PageStore store(make, num_pages);
+    for (size_t page = 0; page < num_pages; page++) {
+        store.writePage(page, data.data() + page * PageStore::PAGE_SIZE);
+    }
+
+    std::vector<uint8_t> page(PageStore::PAGE_SIZE);
+    size_t total = 0;
+    for (size_t p = 0; p < num_pages; p++) {
+        store.readPage(p, page.data());
+        assert(std::memcmp(page.data(), data.data() + p * PageStore::PAGE_SIZE,
+                           PageStore::PAGE_SIZE) == 0);
+
+        size_t lines = 0;
+        for (size_t line = 0; line < PageStore::LINES_PER_PAGE; line++) {
+            size_t size = store.lineCompressedSize(p, line);
+            assert(size > 0 && size <= PageStore::LINE_SIZE);
+            lines += size;
+        }
+        assert(lines == store.compressedSize(p));
+        total += lines;
+    }
+    assert(store.totalCompressedSize() == total);
+    assert(total < data.size());
+
+    // single lines in random order
+    std::mt19937 gen(2);
+    for (int i = 0; i < 2000; i++) {
+        size_t p = gen() % num_pages;
+        size_t line = gen() % PageStore::LINES_PER_PAGE;
+        uint8_t out[PageStore::LINE_SIZE];
+        store.readLine(p, line, out);
+        assert(std::memcmp(out, data.data() + p * PageStore::PAGE_SIZE + line * PageStore::LINE_SIZE,
+                           PageStore::LINE_SIZE) == 0);
+    }
+    std::cout << name << " page store round trip test passed\n";
+}
+
+void testRawLines() {
+    // FPC grows random lines, those are kept raw
+    std::vector<uint8_t> data = makePages(1, 1);
+    std::mt19937 gen(3);
+    for (size_t i = 0; i < PageStore::PAGE_SIZE / 2; i++) {
+        data[i] = static_cast<uint8_t>(gen());
+    }
+    PageStore store(factory<compression::FPC>(), 1);
+    store.writePage(0, data.data());
+    for (size_t line = 0; line < PageStore::LINES_PER_PAGE / 2; line++) {
+        assert(store.lineCompressedSize(0, line) == PageStore::LINE_SIZE);
+    }
+
+    std::vector<uint8_t> page(PageStore::PAGE_SIZE);
+    store.readPage(0, page.data());
+    assert(page == data);
+    uint8_t out[PageStore::LINE_SIZE];
+    store.readLine(0, 5, out);
+    assert(std::memcmp(out, data.data() + 5 * PageStore::LINE_SIZE, PageStore::LINE_SIZE) == 0);
+    std::cout << "Raw lines test passed\n";
+}
+
+void testBatchedWrites() {
+    const size_t num_pages = 100;
+    std::vector<uint8_t> data = makePages(num_pages, 4);
+    PageStore single(factory<compression::BDI>(), num_pages);
+    PageStore batched(factory<compression::BDI>(), num_pages, 4);
+    for (size_t page = 0; page < num_pages; page++) {
+        single.writePage(page, data.data() + page * PageStore::PAGE_SIZE);
+    }
+    batched.writePages(0, data.data(), num_pages);
+
+    std::vector<uint8_t> page(PageStore::PAGE_SIZE);
+    for (size_t p = 0; p < num_pages; p++) {
+        assert(batched.compressedSize(p) == single.compressedSize(p));
+        batched.readPage(p, page.data());
+        assert(std::memcmp(page.data(), data.data() + p * PageStore::PAGE_SIZE,
+                           PageStore::PAGE_SIZE) == 0);
+    }
+    assert(batched.totalCompressedSize() == single.totalCompressedSize());
+
+    // overwriting pages updates the totals
+    std::vector<uint8_t> zeros(10 * PageStore::PAGE_SIZE, 0);
+    batched.writePages(50, zeros.data(), 10);
+    size_t total = 0;
+    for (size_t p = 0; p < num_pages; p++) {
+        total += batched.compressedSize(p);
+    }
+    assert(batched.totalCompressedSize() == total);
+    batched.readPage(55, page.data());
+    assert(std::memcmp(page.data(), zeros.data(), PageStore::PAGE_SIZE) == 0);
+    std::cout << "Batched writes test passed\n";
+}
+
+// threads of this process, 0 where /proc is not available
+size_t processThreads() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::stoul(line.substr(8));
+        }
+    }
+    return 0;
+}
+
+void testInlineWrites() {
+    // one thread runs on the caller, no pool is started
+    size_t before = processThreads();
+    PageStore store(factory<compression::BDI>(), 8);
+    assert(processThreads() == before);
+
+    std::vector<uint8_t> data = makePages(8, 5);
+    store.writePages(0, data.data(), 8);
+    std::vector<uint8_t> page(PageStore::PAGE_SIZE);
+    for (size_t p = 0; p < 8; p++) {
+        store.readPage(p, page.data());
+        assert(std::memcmp(page.data(), data.data() + p * PageStore::PAGE_SIZE,
+                           PageStore::PAGE_SIZE) == 0);
+    }
+    std::cout << "Inline writes test passed\n";
+}
+
+void testUnwrittenAndRange() {
+    PageStore store(factory<compression::BDI>(), 4);
+    std::vector<uint8_t> page(PageStore::PAGE_SIZE, 0xAA);
+    store.readPage(2, page.data());
+    assert(page == std::vector<uint8_t>(PageStore::PAGE_SIZE, 0));
+    assert(store.compressedSize(2) == 0 && store.lineCompressedSize(2, 7) == 0);
+    assert(store.totalCompressedSize() == 0);
+
+    auto rejects = [](auto fn) {
+        try {
+            fn();
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    };
+    uint8_t line[PageStore::LINE_SIZE];
+    assert(rejects([&] { store.readPage(4, page.data()); }));
+    assert(rejects([&] { store.readLine(0, 64, line); }));
+    assert(rejects([&] { store.writePage(4, page.data()); }));
+    assert(rejects([&] { store.writePages(3, page.data(), 2); }));
+    std::cout << "Unwritten pages and range test passed\n";
+}
+
+int main() {
+    testRoundTrip("BDI", factory<compression::BDI>());
+    testRoundTrip("CPack", factory<compression::CPack>());
+    testRoundTrip("Adaptive", factory<compression::Adaptive>());
+    testRawLines();
+    testBatchedWrites();
+    testInlineWrites();
+    testUnwrittenAndRange();
+    return 0;
+}
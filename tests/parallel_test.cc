@@ -0,0 +1,159 @@
+// tests/parallel_test.cc
+#include "compression/parallel.h"
+#include "compression/thread_pool.h"
+#include "compression/adaptive.h"
+#include "compression/ans.h"
+#include "compression/bdi.h"
+#include "compression/cpack.h"
+#include "compression/fpc.h"
+#include "compression/huffman.h"
+#include "compression/lz4.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+// mixed trace-like data: zero pages, small integers, pointers and noise
+std::vector<uint8_t> makeTrace(size_t size, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::vector<uint8_t> data(size, 0);
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t value = 0;
+        switch ((i / 4096) % 4) {
+            case 0: break;
+            case 1: value = gen() % 200; break;
+            case 2: value = 0x00007F3A12340000ull + gen() % 4096; break;
+            case 3: value = (uint64_t(gen()) << 32) | gen(); break;
+        }
+        std::memcpy(&data[i], &value, 8);
+    }
+    return data;
+}
+
+void testThreadPool() {
+    compression::ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    pool.parallelFor(hits.size(), [&](size_t i) { hits[i]++; });
+    for (auto& hit : hits) {
+        assert(hit == 1);
+    }
+
+    // nested loops run on the workers' own queues
+    std::atomic<int> total(0);
+    pool.parallelFor(8, [&](size_t) {
+        pool.parallelFor(8, [&](size_t) { total++; });
+    });
+    assert(total == 64);
+
+    bool thrown = false;
+    try {
+        pool.parallelFor(16, [](size_t i) {
+            if (i == 5) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    // the tasks wait for each other, so they run at once and the caller can
+    // hold only one; the caller returns after the last of them finished
+    const std::thread::id caller = std::this_thread::get_id();
+    const size_t tasks = pool.size();
+    std::mutex mutex;
+    std::condition_variable all_started;
+    size_t started = 0;
+    std::atomic<size_t> on_workers(0);
+    std::atomic<size_t> finished(0);
+    pool.parallelFor(tasks, [&](size_t) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (++started == tasks) {
+                all_started.notify_all();
+            }
+            all_started.wait(lock, [&] { return started == tasks; });
+        }
+        if (std::this_thread::get_id() != caller) {
+            on_workers++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        finished++;
+    });
+    assert(finished == tasks);
+    assert(on_workers >= tasks - 1);
+    std::cout << "Thread pool test passed\n";
+}
+
+void testRoundTrip() {
+    std::vector<uint8_t> input = makeTrace(1 << 20, 1);
+    // a tail that is not a multiple of lines or chunks
+    input.resize(input.size() + 1234, 0x5A);
+
+    std::vector<compression::ParallelCompressor::CodecFactory> factories = {
+        [] { return std::make_unique<compression::BDI>(); },
+        [] { return std::make_unique<compression::FPC>(); },
+        [] { return std::make_unique<compression::CPack>(); },
+        [] { return std::make_unique<compression::LZ4Codec>(); },
+        [] { return std::make_unique<compression::HuffmanCodec>(); },
+        [] { return std::make_unique<compression::ANS>(); },
+        [] { return std::make_unique<compression::Adaptive>(); },
+    };
+    for (auto& factory : factories) {
+        compression::ParallelCompressor parallel(factory, 64 * 1024, 4);
+        std::vector<uint8_t> compressed = parallel.compress(input);
+        assert(compressed.size() < input.size());
+        assert(parallel.decompressedSize(compressed.data(), compressed.size()) == input.size());
+        assert(parallel.decompress(compressed) == input);
+
+        // chunks decode the same with a different thread count
+        compression::ParallelCompressor serial(factory, 64 * 1024, 1);
+        assert(serial.decompress(compressed) == input);
+    }
+    std::cout << "Parallel round trip test passed\n";
+}
+
+void testStoredChunks() {
+    std::mt19937 gen(2);
+    std::vector<uint8_t> input(100000);
+    for (auto& byte : input) {
+        byte = gen();
+    }
+    compression::ParallelCompressor parallel(
+        [] { return std::make_unique<compression::BDI>(); }, 4096, 2);
+    std::vector<uint8_t> compressed = parallel.compress(input);
+    // random data is kept raw, only the header and index are added
+    size_t num_chunks = (input.size() + 4095) / 4096;
+    assert(compressed.size() == compression::ParallelCompressor::HEADER_SIZE +
+                                num_chunks * 4 + input.size());
+    assert(parallel.decompress(compressed) == input);
+
+    std::vector<uint8_t> empty;
+    assert(parallel.decompress(parallel.compress(empty)).empty());
+
+    // a truncated index is rejected
+    compressed.resize(20);
+    bool thrown = false;
+    try {
+        parallel.decompress(compressed);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    std::cout << "Stored chunk test passed\n";
+}
+
+int main() {
+    testThreadPool();
+    testRoundTrip();
+    testStoredChunks();
+
+    std::cout << "All parallel tests passed!\n";
+    return 0;
+}
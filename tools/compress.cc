@@ -0,0 +1,326 @@
+// tools/compress.cc
+//
+// Compress or decompress a file with any codec through ParallelCompressor.
+// Input and output are memory mapped, so no copy of the file is made, and
+// madvise tells the kernel both are read and written front to back.
+//
+//   compress [options] <input> <output>
+//     -d, --decompress       decompress instead of compress
+//     -c, --codec=<name>     bdi, fpc, cpack, lz4, huffman, ans or adaptive,
+//                            lz4 by default; decompression takes the codec
+//                            from the file and rejects a different one
+//     -j, --threads=<n>      worker threads, every hardware thread by default
+//     --chunk-size=<bytes>   independent chunk size, 1 MiB by default
+//
+// The output is an 8 byte header, uint32 magic, uint8 codec id and three
+// zero bytes, followed by the ParallelCompressor stream. Sizes, ratio and
+// throughput go to stderr.
+#include "compression/adaptive.h"
+#include "compression/ans.h"
+#include "compression/bdi.h"
+#include "compression/common.h"
+#include "compression/cpack.h"
+#include "compression/fpc.h"
+#include "compression/huffman.h"
+#include "compression/lz4.h"
+#include "compression/parallel.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using compression::ParallelCompressor;
+
+constexpr uint32_t TOOL_MAGIC = 0x315A4D43;   // "CMZ1"
+constexpr size_t TOOL_HEADER_SIZE = 8;
+
+// the codec id in the header is the index here plus one, append only
+const char* const CODEC_NAMES[] = {"bdi", "fpc", "cpack", "lz4", "huffman", "ans", "adaptive"};
+
+struct Options {
+    bool decompress = false;
+    // empty if not given: lz4 to compress, the file's codec to decompress
+    std::string codec;
+    size_t threads = 0;
+    size_t chunk_size = ParallelCompressor::DEFAULT_CHUNK_SIZE;
+    std::string input;
+    std::string output;
+};
+
+ParallelCompressor::CodecFactory codecFactory(const std::string& name) {
+    if (name == "bdi") {
+        return [] { return std::make_unique<compression::BDI>(); };
+    }
+    if (name == "fpc") {
+        return [] { return std::make_unique<compression::FPC>(); };
+    }
+    if (name == "cpack") {
+        return [] { return std::make_unique<compression::CPack>(); };
+    }
+    if (name == "lz4") {
+        return [] { return std::make_unique<compression::LZ4Codec>(); };
+    }
+    if (name == "huffman") {
+        return [] { return std::make_unique<compression::HuffmanCodec>(); };
+    }
+    if (name == "ans") {
+        return [] { return std::make_unique<compression::ANS>(); };
+    }
+    if (name == "adaptive") {
+        return [] { return std::make_unique<compression::Adaptive>(); };
+    }
+    throw std::runtime_error("Unknown codec " + name);
+}
+
+uint8_t codecId(const std::string& name) {
+    for (size_t i = 0; i < std::size(CODEC_NAMES); i++) {
+        if (name == CODEC_NAMES[i]) {
+            return static_cast<uint8_t>(i + 1);
+        }
+    }
+    throw std::runtime_error("Unknown codec " + name);
+}
+
+// codec named in the header of a compressed file
+std::string headerCodec(const uint8_t* src, size_t src_size) {
+    if (src_size < TOOL_HEADER_SIZE || loadValue<uint32_t>(src) != TOOL_MAGIC) {
+        throw std::runtime_error("Not a compressed file");
+    }
+    uint8_t id = src[4];
+    if (id == 0 || id > std::size(CODEC_NAMES)) {
+        throw std::runtime_error("Unknown codec id " + std::to_string(id));
+    }
+    return CODEC_NAMES[id - 1];
+}
+
+std::string systemError(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+// A file mapped whole, read only for input, shared read-write for output.
+// Empty files are not mapped, data() is null then.
+class MappedFile {
+public:
+    static MappedFile openInput(const std::string& path) {
+        MappedFile file(path, ::open(path.c_str(), O_RDONLY));
+        struct stat st;
+        if (::fstat(file.fd_, &st) != 0) {
+            throw std::runtime_error(systemError("cannot stat", path));
+        }
+        file.map(static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE);
+        return file;
+    }
+
+    // the output is sized to capacity while it is written, truncate()
+    // cuts it to the bytes actually used
+    static MappedFile createOutput(const std::string& path, size_t capacity) {
+        MappedFile file(path, ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644));
+        if (::ftruncate(file.fd_, static_cast<off_t>(capacity)) != 0) {
+            throw std::runtime_error(systemError("cannot resize", path));
+        }
+        file.map(capacity, PROT_READ | PROT_WRITE, MAP_SHARED);
+        return file;
+    }
+
+    MappedFile(MappedFile&& other) noexcept
+        : path_(std::move(other.path_)), fd_(other.fd_), data_(other.data_), size_(other.size_) {
+        other.fd_ = -1;
+        other.data_ = nullptr;
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        unmap();
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    uint8_t* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    void truncate(size_t size) {
+        unmap();
+        if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            throw std::runtime_error(systemError("cannot resize", path_));
+        }
+    }
+
+private:
+    MappedFile(std::string path, int fd) : path_(std::move(path)), fd_(fd) {
+        if (fd_ < 0) {
+            throw std::runtime_error(systemError("cannot open", path_));
+        }
+    }
+
+    void map(size_t size, int prot, int flags) {
+        size_ = size;
+        if (size == 0) {
+            return;
+        }
+        void* addr = ::mmap(nullptr, size, prot, flags, fd_, 0);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error(systemError("cannot map", path_));
+        }
+        data_ = static_cast<uint8_t*>(addr);
+        // chunks are taken in order, read ahead and drop pages behind
+        ::madvise(addr, size, MADV_SEQUENTIAL);
+        if (prot == PROT_READ) {
+            ::madvise(addr, size, MADV_WILLNEED);
+        }
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+            data_ = nullptr;
+        }
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+void usage() {
+    std::cerr << "usage: compress [-d] [-c codec] [-j threads] [--chunk-size=bytes] <input> <output>\n"
+                 "  codecs: bdi, fpc, cpack, lz4 (default), huffman, ans, adaptive\n";
+}
+
+// value of "-x value", "--long=value" or "--long value" at argv[i]
+bool optionValue(int argc, char** argv, int& i, const char* short_name,
+                 const char* long_name, std::string& value) {
+    std::string arg = argv[i];
+    std::string prefix = std::string(long_name) + "=";
+    if (arg.rfind(prefix, 0) == 0) {
+        value = arg.substr(prefix.size());
+        return true;
+    }
+    if (arg == short_name || arg == long_name) {
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for " + arg);
+        }
+        value = argv[++i];
+        return true;
+    }
+    return false;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    std::string value;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-d" || arg == "--decompress") {
+            options.decompress = true;
+        } else if (optionValue(argc, argv, i, "-c", "--codec", value)) {
+            options.codec = value;
+        } else if (optionValue(argc, argv, i, "-j", "--threads", value)) {
+            options.threads = std::stoull(value);
+        } else if (optionValue(argc, argv, i, "--chunk-size", "--chunk-size", value)) {
+            options.chunk_size = std::stoull(value);
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            throw std::runtime_error("Unknown option " + arg);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        throw std::runtime_error("Expected an input and an output file");
+    }
+    options.input = files[0];
+    options.output = files[1];
+    return options;
+}
+
+int run(const Options& options) {
+    MappedFile input = MappedFile::openInput(options.input);
+
+    std::string codec = options.codec.empty() ? "lz4" : options.codec;
+    if (options.decompress) {
+        codec = headerCodec(input.data(), input.size());
+        if (!options.codec.empty() && options.codec != codec) {
+            throw std::runtime_error(options.input + " was compressed with " + codec +
+                                     ", not " + options.codec);
+        }
+    }
+    ParallelCompressor parallel(codecFactory(codec), options.chunk_size, options.threads);
+
+    const uint8_t* stream = input.data() + (options.decompress ? TOOL_HEADER_SIZE : 0);
+    size_t stream_size = input.size() - (options.decompress ? TOOL_HEADER_SIZE : 0);
+    size_t capacity = options.decompress
+        ? parallel.decompressedSize(stream, stream_size)
+        : TOOL_HEADER_SIZE + parallel.maxCompressedSize(input.size());
+    MappedFile output = MappedFile::createOutput(options.output, capacity);
+
+    // a failed run leaves no partial output behind
+    auto start = std::chrono::steady_clock::now();
+    size_t written;
+    try {
+        if (options.decompress) {
+            written = parallel.decompress(stream, stream_size, output.data(), output.size());
+        } else {
+            std::memset(output.data(), 0, TOOL_HEADER_SIZE);
+            storeValue<uint32_t>(output.data(), TOOL_MAGIC);
+            output.data()[4] = codecId(codec);
+            written = TOOL_HEADER_SIZE + parallel.compress(input.data(), input.size(),
+                                                           output.data() + TOOL_HEADER_SIZE,
+                                                           output.size() - TOOL_HEADER_SIZE);
+        }
+    } catch (...) {
+        ::unlink(options.output.c_str());
+        throw;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    output.truncate(written);
+
+    // throughput and ratio over the uncompressed side
+    size_t original = options.decompress ? written : input.size();
+    size_t compressed = options.decompress ? input.size() : written;
+    std::fprintf(stderr, "%s %s: %zu -> %zu bytes, ratio %.3f, %.1f MB/s, threads %zu\n",
+                 codec.c_str(), options.decompress ? "decompress" : "compress",
+                 input.size(), written, compressed ? double(original) / compressed : 0.0,
+                 seconds > 0 ? original / seconds / 1e6 : 0.0, parallel.numThreads());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "compress: " << e.what() << "\n";
+        usage();
+        return 2;
+    }
+
+    try {
+        return run(options);
+    } catch (const std::exception& e) {
+        std::cerr << "compress: " << e.what() << "\n";
+        return 1;
+    }
+}